@@ -0,0 +1,146 @@
+#pragma once
+
+#include "geo.h"
+#include "graph.h"
+#include "router.h"
+#include "search_state.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+    // Поиск A*: Дейкстра, у которой ключ кучи дополнен нижней оценкой остатка пути до цели.
+    // Оценка — расстояние по большому кругу от вершины до цели, умноженное на weight_per_meter
+    // (наименьший вес ребра на метр пройденного по прямой расстояния), поэтому она допустима
+    // и поиск уходит от цели заметно меньше, чем обычная Дейкстра.
+    template<typename Weight>
+    class AStarRouter final : public RouteBuilder<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using RouteInfo = typename RouteBuilder<Weight>::RouteInfo;
+
+        AStarRouter(const Graph &graph, std::vector<geo::Coordinates> vertex_coordinates, double weight_per_meter);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+
+        // Оценки считаются не более одного раза на вершину за запрос. Округлённая до целых оценка
+        // может нарушать монотонность ключей, поэтому куча всегда двоичная
+        struct AStarSearchState {
+            SearchState<Weight, BinaryHeap<Weight>> search;
+            std::vector<Weight> potentials;
+            std::vector<uint32_t> potential_marks;
+        };
+
+        static AStarSearchState &GetSearchState() {
+            static thread_local AStarSearchState state;
+            return state;
+        }
+
+        Weight GetPotential(AStarSearchState &state, VertexId vertex, VertexId to) const;
+
+        const Graph &graph_;
+        std::vector<geo::Coordinates> vertex_coordinates_;
+        double weight_per_meter_ = 0;
+    };
+
+    template<typename Weight>
+    AStarRouter<Weight>::AStarRouter(const Graph &graph, std::vector<geo::Coordinates> vertex_coordinates,
+                                     double weight_per_meter)
+            : graph_(graph), vertex_coordinates_(std::move(vertex_coordinates)), weight_per_meter_(weight_per_meter) {
+        if (!graph.IsFrozen()) {
+            throw std::logic_error("Graph should be frozen before routing");
+        }
+        if (vertex_coordinates_.size() != graph.GetVertexCount()) {
+            throw std::logic_error("Coordinates should be set for every vertex");
+        }
+        if (weight_per_meter_ < 0) {
+            throw std::domain_error("Weight per meter should be non-negative");
+        }
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    template<typename Weight>
+    Weight AStarRouter<Weight>::GetPotential(AStarSearchState &state, VertexId vertex, VertexId to) const {
+        if (state.potential_marks[vertex] != state.search.mark) {
+            state.potential_marks[vertex] = state.search.mark;
+            state.potentials[vertex] = static_cast<Weight>(
+                    geo::ComputeDistance(vertex_coordinates_[vertex], vertex_coordinates_[to]) * weight_per_meter_);
+        }
+        return state.potentials[vertex];
+    }
+
+    template<typename Weight>
+    std::optional<typename AStarRouter<Weight>::RouteInfo> AStarRouter<Weight>::BuildRoute(VertexId from,
+                                                                                           VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            return std::nullopt;
+        }
+
+        auto &state = GetSearchState();
+        auto &search = state.search;
+        search.Reset(vertex_count);
+        if (state.potential_marks.size() < vertex_count) {
+            state.potentials.resize(vertex_count);
+            state.potential_marks.resize(vertex_count, 0);
+        }
+        if (search.mark == 1) {
+            std::fill(state.potential_marks.begin(), state.potential_marks.end(), 0);
+        }
+
+        // В куче лежит вес пути плюс оценка; SearchState::Reach кладёт в кучу сам вес, поэтому здесь вручную
+        auto reach = [&](VertexId vertex, Weight weight, EdgeId prev_edge) {
+            search.marks[vertex] = search.mark;
+            search.weights[vertex] = weight;
+            search.prev_edges[vertex] = prev_edge;
+            search.heap.Push(weight + GetPotential(state, vertex, to), vertex);
+        };
+
+        reach(from, ZERO_WEIGHT, NO_EDGE);
+
+        while (!search.heap.Empty()) {
+            const auto [key, vertex] = search.heap.Pop();
+            const Weight weight = search.weights[vertex];
+            if (weight + GetPotential(state, vertex, to) < key) {
+                continue;
+            }
+            if (vertex == to) {
+                break;
+            }
+            for (size_t arc = graph_.GetArcsBegin(vertex); arc < graph_.GetArcsEnd(vertex); ++arc) {
+                const VertexId target = graph_.GetArcTarget(arc);
+                const Weight candidate_weight = weight + graph_.GetArcWeight(arc);
+                if (!search.IsReached(target) || candidate_weight < search.weights[target]) {
+                    reach(target, candidate_weight, graph_.GetArcEdge(arc));
+                }
+            }
+        }
+
+        if (!search.IsReached(to)) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = search.prev_edges[to]; edge_id != NO_EDGE;
+             edge_id = search.prev_edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{search.weights[to], std::move(edges)};
+    }
+
+}  // namespace graph
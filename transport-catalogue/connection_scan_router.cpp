@@ -0,0 +1,119 @@
+#include "connection_scan_router.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+
+namespace transport_catalogue {
+
+    ConnectionScanRouter::ConnectionScanRouter(const TransportCatalogue &db, double bus_velocity)
+            : stop_count_(db.GetLastStopId()) {
+
+        for (const auto &bus: db.GetAllBuses()) {
+            if (bus->departures.empty() || bus->stops.size() < 2) {
+                continue;
+            }
+            const auto dist_vec = db.GetBusRealDistances(bus);
+            const auto stop_ids = db.GetBusStopIds(bus->id);
+
+            for (const auto departure: bus->departures) {
+                const auto trip = static_cast<uint32_t>(trip_buses_.size());
+                trip_buses_.push_back(bus->id);
+
+                int64_t distance = 0;
+                for (size_t i = 0; i + 1 < bus->stops.size(); ++i) {
+                    const double departure_time = departure + distance / bus_velocity;
+                    distance += dist_vec[i];
+                    connections_.push_back({departure_time, departure + distance / bus_velocity,
+                                            stop_ids.begin()[i], stop_ids.begin()[i + 1],
+                                            trip, static_cast<uint32_t>(i)});
+                }
+            }
+        }
+
+        if (connections_.size() >= NO_CONNECTION) {
+            throw std::length_error("Too many connections in the timetable");
+        }
+
+        // При равном времени отправления раньше идут связи с более ранним прибытием: перегон нулевой длины
+        // другого рейса может довезти до остановки, откуда в тот же момент уходит следующая связь.
+        // Перегоны одного рейса остаются в порядке следования
+        std::sort(connections_.begin(), connections_.end(), [](const Connection &lhs, const Connection &rhs) {
+            return std::tie(lhs.departure_time, lhs.arrival_time, lhs.trip, lhs.position) <
+                   std::tie(rhs.departure_time, rhs.arrival_time, rhs.trip, rhs.position);
+        });
+    }
+
+    std::optional<std::vector<TimetableLeg>>
+    ConnectionScanRouter::BuildRoute(size_t stop_from_id, size_t stop_to_id, double departure_time) const {
+        if (stop_from_id >= stop_count_ || stop_to_id >= stop_count_) {
+            return std::nullopt;
+        }
+
+        auto &state = GetSearchState();
+        state.arrival_times.assign(stop_count_, UNREACHABLE_TIME);
+        state.trip_boardings.assign(trip_buses_.size(), NO_CONNECTION);
+        state.journeys.assign(stop_count_, Journey{});
+        state.arrival_times[stop_from_id] = departure_time;
+
+        const auto first = std::lower_bound(connections_.begin(), connections_.end(), departure_time,
+                                            [](const Connection &connection, double time) {
+                                                return connection.departure_time < time;
+                                            });
+        // Связи с одним временем отправления просматриваются группой. Цепочка перегонов нулевой длины
+        // разных рейсов может идти против порядка сортировки, поэтому после улучшения по такому перегону
+        // группа просматривается ещё раз
+        for (auto group_begin = first; group_begin != connections_.end();) {
+            const double group_time = group_begin->departure_time;
+            if (state.arrival_times[stop_to_id] <= group_time) {
+                break;
+            }
+            const auto group_end = std::find_if(group_begin, connections_.end(),
+                                                [group_time](const Connection &connection) {
+                                                    return connection.departure_time != group_time;
+                                                });
+
+            for (bool is_rescan_needed = true; is_rescan_needed;) {
+                is_rescan_needed = false;
+                for (auto it = group_begin; it != group_end; ++it) {
+                    const auto &connection = *it;
+                    // При повторном просмотре рейс мог быть взят на более поздней остановке цепочки —
+                    // раньше неё на него ещё не сели
+                    auto &boarding = state.trip_boardings[connection.trip];
+                    if (boarding == NO_CONNECTION || connections_[boarding].position > connection.position) {
+                        if (connection.departure_time < state.arrival_times[connection.from_stop]) {
+                            continue;
+                        }
+                        boarding = static_cast<uint32_t>(it - connections_.begin());
+                    }
+                    if (connection.arrival_time < state.arrival_times[connection.to_stop]) {
+                        state.arrival_times[connection.to_stop] = connection.arrival_time;
+                        state.journeys[connection.to_stop] = {boarding,
+                                                              static_cast<uint32_t>(it - connections_.begin())};
+                        is_rescan_needed = is_rescan_needed || connection.arrival_time == group_time;
+                    }
+                }
+            }
+            group_begin = group_end;
+        }
+
+        if (state.arrival_times[stop_to_id] == UNREACHABLE_TIME) {
+            return std::nullopt;
+        }
+
+        std::vector<TimetableLeg> legs;
+        for (size_t stop_id = stop_to_id; stop_id != stop_from_id;) {
+            const auto &journey = state.journeys[stop_id];
+            const auto &board = connections_[journey.board_connection];
+            const auto &alight = connections_[journey.alight_connection];
+            legs.push_back({trip_buses_[board.trip], board.from_stop,
+                            static_cast<int>(alight.position - board.position + 1),
+                            board.departure_time, alight.arrival_time});
+            stop_id = board.from_stop;
+        }
+        std::reverse(legs.begin(), legs.end());
+
+        return legs;
+    }
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+
+    // Участок поездки по расписанию: посадка на рейс автобуса bus_id на остановке board_stop_id
+    // в момент departure_time и выход через span остановок в момент arrival_time
+    struct TimetableLeg {
+        size_t bus_id = 0;
+        size_t board_stop_id = 0;
+        int span = 0;
+        double departure_time = 0;
+        double arrival_time = 0;
+    };
+
+    // Поиск по расписанию алгоритмом Connection Scan. Рейс — проход автобуса по всем остановкам
+    // маршрута с отправлением из Bus::departures, связь — перегон рейса между соседними остановками.
+    // Связи лежат одним массивом по возрастанию времени отправления, и запрос — один линейный
+    // проход по нему начиная с момента отправления.
+    class ConnectionScanRouter {
+    public:
+        ConnectionScanRouter(const TransportCatalogue &db, double bus_velocity);
+
+        // Самый ранний приезд из stop_from_id в stop_to_id при отправлении не раньше departure_time
+        std::optional<std::vector<TimetableLeg>> BuildRoute(size_t stop_from_id, size_t stop_to_id,
+                                                           double departure_time) const;
+
+    private:
+        static constexpr double UNREACHABLE_TIME = std::numeric_limits<double>::infinity();
+        static constexpr uint32_t NO_CONNECTION = std::numeric_limits<uint32_t>::max();
+
+        struct Connection {
+            double departure_time = 0;
+            double arrival_time = 0;
+            uint32_t from_stop = 0;
+            uint32_t to_stop = 0;
+            uint32_t trip = 0;
+            // Номер перегона в рейсе
+            uint32_t position = 0;
+        };
+
+        // Для остановки — связи посадки и выхода последнего участка лучшего пути к ней
+        struct Journey {
+            uint32_t board_connection = NO_CONNECTION;
+            uint32_t alight_connection = NO_CONNECTION;
+        };
+
+        struct SearchState {
+            std::vector<double> arrival_times;
+            std::vector<uint32_t> trip_boardings;
+            std::vector<Journey> journeys;
+        };
+
+        static SearchState &GetSearchState() {
+            static thread_local SearchState state;
+            return state;
+        }
+
+        size_t stop_count_ = 0;
+        std::vector<size_t> trip_buses_;
+        std::vector<Connection> connections_;
+    };
+
+}
@@ -0,0 +1,462 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "search_state.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <transport_router.pb.h>
+
+namespace graph {
+
+    // Иерархия сжатий (Contraction Hierarchies). Вершины сжимаются по очереди, недостающие
+    // кратчайшие пути заменяются шорткатами; запрос — двунаправленный поиск только "вверх" по рангам.
+    // Рёбра нумеруются сквозным образом: [0, E) — рёбра исходного графа, [E, E + S) — шорткаты.
+    template<typename Weight>
+    class ContractionHierarchy final : public RouteBuilder<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using RouteInfo = typename RouteBuilder<Weight>::RouteInfo;
+
+        explicit ContractionHierarchy(const Graph &graph);
+
+        ContractionHierarchy(const Graph &graph,
+                             const transport_catalogue_protobuf::ContractionHierarchy &proto_contraction_hierarchy);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        const std::vector<uint32_t> &GetRanks() const {
+            return ranks_;
+        }
+
+        void Deserialize(const transport_catalogue_protobuf::ContractionHierarchy &proto_contraction_hierarchy);
+
+        transport_catalogue_protobuf::ContractionHierarchy Serialize() const;
+
+    private:
+        struct Shortcut {
+            VertexId from{};
+            VertexId to{};
+            Weight weight{};
+            EdgeId first{};
+            EdgeId second{};
+        };
+
+        struct SearchEdge {
+            VertexId head{};
+            Weight weight{};
+            EdgeId id{};
+        };
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr size_t WITNESS_SETTLE_LIMIT = 500;
+
+        VertexId GetFrom(EdgeId edge_id) const {
+            return edge_id < original_edge_count_ ? graph_.GetEdge(edge_id).from
+                                                  : shortcuts_[edge_id - original_edge_count_].from;
+        }
+
+        VertexId GetTo(EdgeId edge_id) const {
+            return edge_id < original_edge_count_ ? graph_.GetEdge(edge_id).to
+                                                  : shortcuts_[edge_id - original_edge_count_].to;
+        }
+
+        Weight GetWeight(EdgeId edge_id) const {
+            return edge_id < original_edge_count_ ? graph_.GetEdge(edge_id).weight
+                                                  : shortcuts_[edge_id - original_edge_count_].weight;
+        }
+
+        void Contract();
+
+        std::vector<Shortcut> FindShortcuts(VertexId vertex, const std::vector<std::vector<EdgeId>> &out_edges,
+                                            const std::vector<std::vector<EdgeId>> &in_edges,
+                                            const std::vector<bool> &contracted) const;
+
+        void BuildSearchGraph();
+
+        void UnpackEdge(EdgeId edge_id, std::vector<EdgeId> &edges) const;
+
+        static std::pair<SearchState<Weight>, SearchState<Weight>> &GetSearchStates() {
+            static thread_local std::pair<SearchState<Weight>, SearchState<Weight>> states;
+            return states;
+        }
+
+        const Graph &graph_;
+        size_t original_edge_count_ = 0;
+        std::vector<uint32_t> ranks_;
+        std::vector<Shortcut> shortcuts_;
+
+        std::vector<size_t> up_offsets_;
+        std::vector<SearchEdge> up_edges_;
+        std::vector<size_t> down_offsets_;
+        std::vector<SearchEdge> down_edges_;
+    };
+
+    template<typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(const Graph &graph)
+            : graph_(graph), original_edge_count_(graph.GetEdgeCount()) {
+        for (EdgeId edge_id = 0; edge_id < original_edge_count_; ++edge_id) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        Contract();
+        BuildSearchGraph();
+    }
+
+    template<typename Weight>
+    ContractionHierarchy<Weight>::ContractionHierarchy(
+            const Graph &graph,
+            const transport_catalogue_protobuf::ContractionHierarchy &proto_contraction_hierarchy)
+            : graph_(graph), original_edge_count_(graph.GetEdgeCount()) {
+        Deserialize(proto_contraction_hierarchy);
+    }
+
+    template<typename Weight>
+    std::vector<typename ContractionHierarchy<Weight>::Shortcut>
+    ContractionHierarchy<Weight>::FindShortcuts(VertexId vertex, const std::vector<std::vector<EdgeId>> &out_edges,
+                                                const std::vector<std::vector<EdgeId>> &in_edges,
+                                                const std::vector<bool> &contracted) const {
+        // Из параллельных рёбер в сжатии участвует только самое лёгкое
+        auto collect_lightest = [this, vertex, &contracted](const std::vector<EdgeId> &edges, bool by_head) {
+            std::vector<std::pair<VertexId, EdgeId>> neighbours;
+            for (const EdgeId edge_id: edges) {
+                const VertexId neighbour = by_head ? GetTo(edge_id) : GetFrom(edge_id);
+                if (neighbour != vertex && !contracted[neighbour]) {
+                    neighbours.emplace_back(neighbour, edge_id);
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end(), [this](const auto &lhs, const auto &rhs) {
+                return lhs.first != rhs.first ? lhs.first < rhs.first : GetWeight(lhs.second) < GetWeight(rhs.second);
+            });
+            neighbours.erase(std::unique(neighbours.begin(), neighbours.end(), [](const auto &lhs, const auto &rhs) {
+                return lhs.first == rhs.first;
+            }), neighbours.end());
+            return neighbours;
+        };
+
+        const auto sources = collect_lightest(in_edges[vertex], false);
+        const auto targets = collect_lightest(out_edges[vertex], true);
+
+        std::vector<Shortcut> shortcuts;
+        if (sources.empty() || targets.empty()) {
+            return shortcuts;
+        }
+
+        auto &witness = GetSearchStates().first;
+        for (const auto &[source, in_edge]: sources) {
+            const Weight in_weight = GetWeight(in_edge);
+            Weight max_weight = ZERO_WEIGHT;
+            for (const auto &[target, out_edge]: targets) {
+                max_weight = std::max(max_weight, in_weight + GetWeight(out_edge));
+            }
+
+            // Поиск свидетелей: кратчайшие пути из source в обход сжимаемой вершины
+            witness.Reset(graph_.GetVertexCount());
+            witness.Reach(source, ZERO_WEIGHT, NO_EDGE);
+            size_t settled = 0;
+            while (!witness.heap.Empty() && settled < WITNESS_SETTLE_LIMIT) {
+                const auto [weight, current] = witness.heap.Pop();
+                if (witness.weights[current] < weight) {
+                    continue;
+                }
+                if (max_weight < weight) {
+                    break;
+                }
+                ++settled;
+                for (const EdgeId edge_id: out_edges[current]) {
+                    const VertexId head = GetTo(edge_id);
+                    if (head == vertex || contracted[head]) {
+                        continue;
+                    }
+                    const Weight candidate_weight = weight + GetWeight(edge_id);
+                    if (!witness.IsReached(head) || candidate_weight < witness.weights[head]) {
+                        witness.Reach(head, candidate_weight, edge_id);
+                    }
+                }
+            }
+
+            for (const auto &[target, out_edge]: targets) {
+                if (target == source) {
+                    continue;
+                }
+                const Weight shortcut_weight = in_weight + GetWeight(out_edge);
+                if (witness.IsReached(target) && !(shortcut_weight < witness.weights[target])) {
+                    continue;
+                }
+                shortcuts.push_back({source, target, shortcut_weight, in_edge, out_edge});
+            }
+        }
+        return shortcuts;
+    }
+
+    template<typename Weight>
+    void ContractionHierarchy<Weight>::Contract() {
+        const size_t vertex_count = graph_.GetVertexCount();
+
+        std::vector<std::vector<EdgeId>> out_edges(vertex_count);
+        std::vector<std::vector<EdgeId>> in_edges(vertex_count);
+        for (EdgeId edge_id = 0; edge_id < original_edge_count_; ++edge_id) {
+            const auto &edge = graph_.GetEdge(edge_id);
+            if (edge.from != edge.to) {
+                out_edges[edge.from].push_back(edge_id);
+                in_edges[edge.to].push_back(edge_id);
+            }
+        }
+
+        std::vector<bool> contracted(vertex_count, false);
+        std::vector<int> contracted_neighbours(vertex_count, 0);
+
+        // Приоритет сжатия: разность добавляемых шорткатов и удаляемых рёбер плюс число уже сжатых соседей
+        auto compute_priority = [&](VertexId vertex) {
+            const auto shortcut_count = static_cast<int>(
+                    FindShortcuts(vertex, out_edges, in_edges, contracted).size());
+            const auto edge_count = static_cast<int>(out_edges[vertex].size() + in_edges[vertex].size());
+            return shortcut_count - edge_count + contracted_neighbours[vertex];
+        };
+
+        using QueueItem = std::pair<int, VertexId>;
+        std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>> queue;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            queue.emplace(compute_priority(vertex), vertex);
+        }
+
+        ranks_.assign(vertex_count, 0);
+        uint32_t next_rank = 0;
+        while (!queue.empty()) {
+            const VertexId vertex = queue.top().second;
+            queue.pop();
+            if (contracted[vertex]) {
+                continue;
+            }
+
+            // Ленивое обновление: приоритет пересчитывается при извлечении
+            const int priority = compute_priority(vertex);
+            if (!queue.empty() && queue.top().first < priority) {
+                queue.emplace(priority, vertex);
+                continue;
+            }
+
+            for (const auto &shortcut: FindShortcuts(vertex, out_edges, in_edges, contracted)) {
+                const EdgeId edge_id = original_edge_count_ + shortcuts_.size();
+                shortcuts_.push_back(shortcut);
+                out_edges[shortcut.from].push_back(edge_id);
+                in_edges[shortcut.to].push_back(edge_id);
+            }
+
+            contracted[vertex] = true;
+            ranks_[vertex] = next_rank++;
+
+            for (const EdgeId edge_id: out_edges[vertex]) {
+                ++contracted_neighbours[GetTo(edge_id)];
+            }
+            for (const EdgeId edge_id: in_edges[vertex]) {
+                ++contracted_neighbours[GetFrom(edge_id)];
+            }
+
+            // Рёбра к сжатым вершинам больше не нужны ни для поиска свидетелей, ни для приоритетов
+            for (auto *edges: {&out_edges, &in_edges}) {
+                for (const EdgeId edge_id: (*edges)[vertex]) {
+                    const VertexId neighbour = edges == &out_edges ? GetTo(edge_id) : GetFrom(edge_id);
+                    auto &neighbour_edges = edges == &out_edges ? in_edges[neighbour] : out_edges[neighbour];
+                    neighbour_edges.erase(std::remove(neighbour_edges.begin(), neighbour_edges.end(), edge_id),
+                                          neighbour_edges.end());
+                }
+                (*edges)[vertex].clear();
+                (*edges)[vertex].shrink_to_fit();
+            }
+        }
+    }
+
+    template<typename Weight>
+    void ContractionHierarchy<Weight>::BuildSearchGraph() {
+        const size_t vertex_count = graph_.GetVertexCount();
+        const size_t edge_count = original_edge_count_ + shortcuts_.size();
+
+        up_offsets_.assign(vertex_count + 1, 0);
+        down_offsets_.assign(vertex_count + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            const VertexId from = GetFrom(edge_id);
+            const VertexId to = GetTo(edge_id);
+            if (ranks_[from] < ranks_[to]) {
+                ++up_offsets_[from + 1];
+            } else if (ranks_[to] < ranks_[from]) {
+                ++down_offsets_[to + 1];
+            }
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            up_offsets_[vertex + 1] += up_offsets_[vertex];
+            down_offsets_[vertex + 1] += down_offsets_[vertex];
+        }
+
+        up_edges_.resize(up_offsets_.back());
+        down_edges_.resize(down_offsets_.back());
+        std::vector<size_t> up_positions(up_offsets_.begin(), std::prev(up_offsets_.end()));
+        std::vector<size_t> down_positions(down_offsets_.begin(), std::prev(down_offsets_.end()));
+        for (EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+            const VertexId from = GetFrom(edge_id);
+            const VertexId to = GetTo(edge_id);
+            if (ranks_[from] < ranks_[to]) {
+                up_edges_[up_positions[from]++] = {to, GetWeight(edge_id), edge_id};
+            } else if (ranks_[to] < ranks_[from]) {
+                down_edges_[down_positions[to]++] = {from, GetWeight(edge_id), edge_id};
+            }
+        }
+    }
+
+    template<typename Weight>
+    void ContractionHierarchy<Weight>::UnpackEdge(EdgeId edge_id, std::vector<EdgeId> &edges) const {
+        std::vector<EdgeId> stack{edge_id};
+        while (!stack.empty()) {
+            const EdgeId current = stack.back();
+            stack.pop_back();
+            if (current < original_edge_count_) {
+                edges.push_back(current);
+            } else {
+                const auto &shortcut = shortcuts_[current - original_edge_count_];
+                stack.push_back(shortcut.second);
+                stack.push_back(shortcut.first);
+            }
+        }
+    }
+
+    template<typename Weight>
+    std::optional<typename ContractionHierarchy<Weight>::RouteInfo>
+    ContractionHierarchy<Weight>::BuildRoute(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            return std::nullopt;
+        }
+
+        auto &[forward, backward] = GetSearchStates();
+        forward.Reset(vertex_count);
+        backward.Reset(vertex_count);
+        forward.Reach(from, ZERO_WEIGHT, NO_EDGE);
+        backward.Reach(to, ZERO_WEIGHT, NO_EDGE);
+
+        std::optional<Weight> best_weight;
+        VertexId meeting_vertex = from;
+
+        while (!forward.heap.Empty() || !backward.heap.Empty()) {
+            const bool is_forward = backward.heap.Empty() ||
+                                    (!forward.heap.Empty() && !(backward.heap.Top().first < forward.heap.Top().first));
+            auto &state = is_forward ? forward : backward;
+            const auto &other = is_forward ? backward : forward;
+
+            const auto [weight, vertex] = state.heap.Pop();
+            if (state.weights[vertex] < weight) {
+                continue;
+            }
+            if (best_weight && !(weight < *best_weight)) {
+                state.heap.Clear();
+                continue;
+            }
+            if (other.IsReached(vertex)) {
+                const Weight candidate_weight = weight + other.weights[vertex];
+                if (!best_weight || candidate_weight < *best_weight) {
+                    best_weight = candidate_weight;
+                    meeting_vertex = vertex;
+                }
+            }
+
+            const auto &offsets = is_forward ? up_offsets_ : down_offsets_;
+            const auto &search_edges = is_forward ? up_edges_ : down_edges_;
+            for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+                const auto &search_edge = search_edges[i];
+                const Weight candidate_weight = weight + search_edge.weight;
+                if (!state.IsReached(search_edge.head) || candidate_weight < state.weights[search_edge.head]) {
+                    state.Reach(search_edge.head, candidate_weight, search_edge.id);
+                }
+            }
+        }
+
+        if (!best_weight) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> upward_edges;
+        for (VertexId vertex = meeting_vertex; forward.prev_edges[vertex] != NO_EDGE;
+             vertex = GetFrom(forward.prev_edges[vertex])) {
+            upward_edges.push_back(forward.prev_edges[vertex]);
+        }
+
+        std::vector<EdgeId> edges;
+        for (auto it = upward_edges.rbegin(); it != upward_edges.rend(); ++it) {
+            UnpackEdge(*it, edges);
+        }
+        for (VertexId vertex = meeting_vertex; backward.prev_edges[vertex] != NO_EDGE;
+             vertex = GetTo(backward.prev_edges[vertex])) {
+            UnpackEdge(backward.prev_edges[vertex], edges);
+        }
+
+        return RouteInfo{*best_weight, std::move(edges)};
+    }
+
+    template<typename Weight>
+    void ContractionHierarchy<Weight>::Deserialize(
+            const transport_catalogue_protobuf::ContractionHierarchy &proto_contraction_hierarchy) {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (static_cast<size_t>(proto_contraction_hierarchy.ranks_size()) != vertex_count) {
+            throw std::runtime_error("Contraction hierarchy ranks don't match the graph, rebuild the base");
+        }
+        ranks_.assign(proto_contraction_hierarchy.ranks().begin(), proto_contraction_hierarchy.ranks().end());
+
+        shortcuts_.clear();
+        shortcuts_.reserve(proto_contraction_hierarchy.shortcuts_size());
+        for (const auto &proto_shortcut: proto_contraction_hierarchy.shortcuts()) {
+            // Шорткат составлен из рёбер, существовавших до него, поэтому его номер больше номеров его частей,
+            // и распаковка всегда завершается
+            const size_t edge_id = original_edge_count_ + shortcuts_.size();
+            if (proto_shortcut.from() >= vertex_count || proto_shortcut.to() >= vertex_count
+                || proto_shortcut.first_edge() >= edge_id || proto_shortcut.second_edge() >= edge_id) {
+                throw std::runtime_error("Contraction hierarchy shortcut doesn't match the graph, rebuild the base");
+            }
+            Weight weight;
+            if constexpr (std::is_integral_v<Weight>) {
+                weight = proto_shortcut.integer_weight();
+            } else {
+                weight = proto_shortcut.weight();
+            }
+            shortcuts_.push_back({proto_shortcut.from(), proto_shortcut.to(), weight,
+                                  proto_shortcut.first_edge(), proto_shortcut.second_edge()});
+        }
+
+        BuildSearchGraph();
+    }
+
+    template<typename Weight>
+    transport_catalogue_protobuf::ContractionHierarchy ContractionHierarchy<Weight>::Serialize() const {
+        transport_catalogue_protobuf::ContractionHierarchy proto_contraction_hierarchy;
+
+        for (const auto rank: ranks_) {
+            proto_contraction_hierarchy.add_ranks(rank);
+        }
+
+        for (const auto &shortcut: shortcuts_) {
+            transport_catalogue_protobuf::Shortcut proto_shortcut;
+            proto_shortcut.set_from(shortcut.from);
+            proto_shortcut.set_to(shortcut.to);
+            if constexpr (std::is_integral_v<Weight>) {
+                proto_shortcut.set_integer_weight(shortcut.weight);
+            } else {
+                proto_shortcut.set_weight(shortcut.weight);
+            }
+            proto_shortcut.set_first_edge(shortcut.first);
+            proto_shortcut.set_second_edge(shortcut.second);
+            *proto_contraction_hierarchy.add_shortcuts() = std::move(proto_shortcut);
+        }
+        return proto_contraction_hierarchy;
+    }
+
+}  // namespace graph
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "search_state.h"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Поиск маршрута алгоритмом Дейкстры в момент запроса: не требует предрасчёта,
+    // поэтому построение базы линейно по размеру графа
+    template<typename Weight>
+    class DijkstraRouter final : public RouteBuilder<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using RouteInfo = typename RouteBuilder<Weight>::RouteInfo;
+
+        explicit DijkstraRouter(const Graph &graph);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    private:
+        static constexpr Weight ZERO_WEIGHT{};
+
+        static SearchState<Weight> &GetSearchState() {
+            static thread_local SearchState<Weight> state;
+            return state;
+        }
+
+        const Graph &graph_;
+    };
+
+    template<typename Weight>
+    DijkstraRouter<Weight>::DijkstraRouter(const Graph &graph) : graph_(graph) {
+        if (!graph.IsFrozen()) {
+            throw std::logic_error("Graph should be frozen before routing");
+        }
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    template<typename Weight>
+    std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                                 VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            return std::nullopt;
+        }
+
+        auto &state = GetSearchState();
+        state.Reset(vertex_count);
+        state.Reach(from, ZERO_WEIGHT, NO_EDGE);
+
+        while (!state.heap.Empty()) {
+            const auto [weight, vertex] = state.heap.Pop();
+            if (state.weights[vertex] < weight) {
+                continue;
+            }
+            if (vertex == to) {
+                break;
+            }
+            for (size_t arc = graph_.GetArcsBegin(vertex); arc < graph_.GetArcsEnd(vertex); ++arc) {
+                const VertexId target = graph_.GetArcTarget(arc);
+                const Weight candidate_weight = weight + graph_.GetArcWeight(arc);
+                if (!state.IsReached(target) || candidate_weight < state.weights[target]) {
+                    state.Reach(target, candidate_weight, graph_.GetArcEdge(arc));
+                }
+            }
+        }
+
+        if (!state.IsReached(to)) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (EdgeId edge_id = state.prev_edges[to]; edge_id != NO_EDGE;
+             edge_id = state.prev_edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{state.weights[to], std::move(edges)};
+    }
+
+    // Все вершины, достижимые из from с весом не больше max_weight, в порядке возрастания веса.
+    // Поиск Дейкстры останавливается, как только вес очередной вершины превышает бюджет
+    template<typename Weight>
+    std::vector<std::pair<VertexId, Weight>> FindReachableVertices(const DirectedWeightedGraph<Weight> &graph,
+                                                                   VertexId from, Weight max_weight) {
+        static thread_local SearchState<Weight> state;
+
+        std::vector<std::pair<VertexId, Weight>> reachable_vertices;
+        const size_t vertex_count = graph.GetVertexCount();
+        if (from >= vertex_count) {
+            return reachable_vertices;
+        }
+
+        state.Reset(vertex_count);
+        state.Reach(from, Weight{}, NO_EDGE);
+
+        while (!state.heap.Empty()) {
+            const auto [weight, vertex] = state.heap.Pop();
+            if (state.weights[vertex] < weight) {
+                continue;
+            }
+            if (max_weight < weight) {
+                break;
+            }
+            reachable_vertices.emplace_back(vertex, weight);
+            for (size_t arc = graph.GetArcsBegin(vertex); arc < graph.GetArcsEnd(vertex); ++arc) {
+                const VertexId target = graph.GetArcTarget(arc);
+                const Weight candidate_weight = weight + graph.GetArcWeight(arc);
+                if (!state.IsReached(target) || candidate_weight < state.weights[target]) {
+                    state.Reach(target, candidate_weight, graph.GetArcEdge(arc));
+                }
+            }
+        }
+        return reachable_vertices;
+    }
+
+    // Веса кратчайших путей из from до каждой из targets за один поиск Дейкстры,
+    // который останавливается, как только извлечены все цели
+    template<typename Weight>
+    std::vector<std::optional<Weight>> ComputeRouteWeights(const DirectedWeightedGraph<Weight> &graph, VertexId from,
+                                                           const std::vector<VertexId> &targets) {
+        static thread_local SearchState<Weight> state;
+        static thread_local std::vector<bool> is_target;
+
+        std::vector<std::optional<Weight>> route_weights(targets.size());
+        const size_t vertex_count = graph.GetVertexCount();
+        if (from >= vertex_count) {
+            return route_weights;
+        }
+
+        is_target.resize(std::max(is_target.size(), vertex_count), false);
+        size_t targets_left = 0;
+        for (const VertexId target: targets) {
+            if (target < vertex_count && !is_target[target]) {
+                is_target[target] = true;
+                ++targets_left;
+            }
+        }
+
+        state.Reset(vertex_count);
+        state.Reach(from, Weight{}, NO_EDGE);
+
+        while (!state.heap.Empty() && targets_left > 0) {
+            const auto [weight, vertex] = state.heap.Pop();
+            if (state.weights[vertex] < weight) {
+                continue;
+            }
+            if (is_target[vertex]) {
+                is_target[vertex] = false;
+                --targets_left;
+            }
+            for (size_t arc = graph.GetArcsBegin(vertex); arc < graph.GetArcsEnd(vertex); ++arc) {
+                const VertexId target = graph.GetArcTarget(arc);
+                const Weight candidate_weight = weight + graph.GetArcWeight(arc);
+                if (!state.IsReached(target) || candidate_weight < state.weights[target]) {
+                    state.Reach(target, candidate_weight, graph.GetArcEdge(arc));
+                }
+            }
+        }
+
+        for (size_t i = 0; i < targets.size(); ++i) {
+            if (targets[i] < vertex_count) {
+                is_target[targets[i]] = false;
+                if (state.IsReached(targets[i])) {
+                    route_weights[i] = state.weights[targets[i]];
+                }
+            }
+        }
+        return route_weights;
+    }
+
+}  // namespace graph
@@ -3,14 +3,17 @@
 #include <string>
 #include <string_view>
 #include <algorithm>
+#include <cstdint>
 #include <deque>
 #include <unordered_map>
 #include <utility>
 #include <stdexcept>
 #include <set>
 #include <optional>
+#include <vector>
 
 #include "geo.h"
+#include "ranges.h"
 
 
 /*
@@ -39,6 +42,12 @@ namespace transport_catalogue {
         int uniq_stops_num = 0;
         bool is_circled = false;
         size_t id = 0;
+        // Отправления рейсов с первой остановки, минуты от начала суток по возрастанию
+        std::vector<double> departures{};
+        // Длины маршрута по прямой и по дорогам; заполняются TransportCatalogue::Freeze
+        double route_length = 0;
+        int real_length = 0;
+        double curvature = 0;
     };
 
     struct BusInfoResponse {
@@ -50,15 +59,20 @@ namespace transport_catalogue {
         double curvature = 0;
     };
 
+    // Срез плоского массива номеров в замороженном справочнике
+    using IdRange = ranges::Range<std::vector<uint32_t>::const_iterator>;
+
     struct StopInfoResponse {
         std::string_view stop_name;
-        std::vector<Bus *> buses;
+        // Номера автобусов по возрастанию названий — срез индекса справочника, без копирования
+        IdRange buses;
     };
 
     struct InputBusInfo {
         std::string bus_name;
         std::deque<std::string> stops;
         bool is_circled = false;
+        std::vector<double> departures{};
     };
 
     struct InputStopInfo {
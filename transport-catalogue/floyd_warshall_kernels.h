@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSPORT_CATALOGUE_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+namespace graph::detail {
+
+    // Ядро релаксации для алгоритма Флойда–Уоршелла: отрезок строки i улучшается путями через вершину k.
+    // through_* — тот же отрезок строки k, weight_to_through и prev_edge_to_through — ячейка (i, k).
+    // Недостижимость кодируется бесконечным (или максимальным) весом, отсутствие ребра — no_prev_edge.
+    template<typename Weight, typename PrevEdge>
+    void RelaxRowScalar(Weight weight_to_through, PrevEdge prev_edge_to_through, const Weight *through_weights,
+                        const PrevEdge *through_prev_edges, Weight *row_weights, PrevEdge *row_prev_edges,
+                        size_t count, Weight unreachable_weight, PrevEdge no_prev_edge) {
+        for (size_t j = 0; j < count; ++j) {
+            if (through_weights[j] == unreachable_weight) {
+                continue;
+            }
+            const Weight candidate_weight = weight_to_through + through_weights[j];
+            if (candidate_weight < row_weights[j]) {
+                row_weights[j] = candidate_weight;
+                row_prev_edges[j] = through_prev_edges[j] != no_prev_edge ? through_prev_edges[j] : prev_edge_to_through;
+            }
+        }
+    }
+
+#ifdef TRANSPORT_CATALOGUE_AVX2_KERNEL
+
+    // Векторная версия для весов double: бесконечность в строке k даёт бесконечного кандидата,
+    // поэтому ветвление не нужно — сравнение и смешивание (blend) по маске
+    __attribute__((target("avx2")))
+    inline void RelaxRowAvx2(double weight_to_through, uint32_t prev_edge_to_through, const double *through_weights,
+                             const uint32_t *through_prev_edges, double *row_weights, uint32_t *row_prev_edges,
+                             size_t count, uint32_t no_prev_edge) {
+        const __m256d weight_to_through_vec = _mm256_set1_pd(weight_to_through);
+        const __m128i prev_edge_to_through_vec = _mm_set1_epi32(static_cast<int>(prev_edge_to_through));
+        const __m128i no_prev_edge_vec = _mm_set1_epi32(static_cast<int>(no_prev_edge));
+        const __m256i mask_lanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+
+        size_t j = 0;
+        for (; j + 4 <= count; j += 4) {
+            const __m256d candidate = _mm256_add_pd(weight_to_through_vec, _mm256_loadu_pd(through_weights + j));
+            const __m256d current = _mm256_loadu_pd(row_weights + j);
+            const __m256d improved = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+            if (_mm256_testz_pd(improved, improved)) {
+                continue;
+            }
+            _mm256_storeu_pd(row_weights + j, _mm256_blendv_pd(current, candidate, improved));
+
+            const __m128i improved_mask = _mm256_castsi256_si128(
+                    _mm256_permutevar8x32_epi32(_mm256_castpd_si256(improved), mask_lanes));
+            const __m128i through_prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(through_prev_edges + j));
+            const __m128i candidate_prev = _mm_blendv_epi8(through_prev, prev_edge_to_through_vec,
+                                                           _mm_cmpeq_epi32(through_prev, no_prev_edge_vec));
+            const __m128i current_prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row_prev_edges + j));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(row_prev_edges + j),
+                             _mm_blendv_epi8(current_prev, candidate_prev, improved_mask));
+        }
+
+        RelaxRowScalar(weight_to_through, prev_edge_to_through, through_weights + j, through_prev_edges + j,
+                       row_weights + j, row_prev_edges + j, count - j, std::numeric_limits<double>::infinity(),
+                       no_prev_edge);
+    }
+
+    inline bool HasAvx2() {
+        static const bool has_avx2 = __builtin_cpu_supports("avx2");
+        return has_avx2;
+    }
+
+#endif
+
+    template<typename Weight, typename PrevEdge>
+    void RelaxRow(Weight weight_to_through, PrevEdge prev_edge_to_through, const Weight *through_weights,
+                  const PrevEdge *through_prev_edges, Weight *row_weights, PrevEdge *row_prev_edges,
+                  size_t count, Weight unreachable_weight, PrevEdge no_prev_edge) {
+#ifdef TRANSPORT_CATALOGUE_AVX2_KERNEL
+        if constexpr (std::is_same_v<Weight, double> && std::is_same_v<PrevEdge, uint32_t>) {
+            if (unreachable_weight == std::numeric_limits<double>::infinity() && HasAvx2()) {
+                RelaxRowAvx2(weight_to_through, prev_edge_to_through, through_weights, through_prev_edges,
+                             row_weights, row_prev_edges, count, no_prev_edge);
+                return;
+            }
+        }
+#endif
+        RelaxRowScalar(weight_to_through, prev_edge_to_through, through_weights, through_prev_edges,
+                       row_weights, row_prev_edges, count, unreachable_weight, no_prev_edge);
+    }
+
+}  // namespace graph::detail
@@ -2,14 +2,22 @@
 
 #include "ranges.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <graph.pb.h>
 
 namespace graph {
 
-    using VertexId = size_t;
+    // Номера вершин 32-битные: Edge<uint32_t> занимает 12 байт, Edge<double> — 16
+    using VertexId = uint32_t;
     using EdgeId = size_t;
 
 
@@ -20,113 +28,263 @@ namespace graph {
         Weight weight;
     };
 
+    // Граф строится через AddEdge, после чего Freeze() переводит его в компактный формат CSR:
+    // исходящие рёбра вершины v лежат в позициях [GetArcsBegin(v), GetArcsEnd(v)) плоских массивов
+    // номеров рёбер, концов и весов. Номера рёбер при этом не меняются. Список рёбер после Freeze()
+    // не хранится: ребро по номеру собирается из его начала и позиции в массивах CSR.
+    // Номера в массивах 32-битные — на ребро уходит 16 байт плюс вес
     template<typename Weight>
     class DirectedWeightedGraph {
     private:
-        using IncidenceList = std::vector<EdgeId>;
-        using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+        using IncidenceList = std::vector<uint32_t>;
+        using IncidentEdgesRange = ranges::Range<const uint32_t *>;
 
     public:
         DirectedWeightedGraph() = default;
 
         explicit DirectedWeightedGraph(size_t vertex_count);
 
+        // Граф из готового списка рёбер, номер ребра — его позиция в списке; граф сразу заморожен
+        DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges);
+
         EdgeId AddEdge(const Edge<Weight> &edge);
 
+        void Freeze();
+
+        bool IsFrozen() const {
+            return is_frozen_;
+        }
+
         size_t GetVertexCount() const;
 
         size_t GetEdgeCount() const;
 
-        const Edge<Weight> &GetEdge(EdgeId edge_id) const;
+        Edge<Weight> GetEdge(EdgeId edge_id) const;
 
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
 
-        std::vector<Edge<Weight>> &GetEdges() {
-            return edges_;
+        size_t GetArcsBegin(VertexId vertex) const {
+            return arc_offsets_[vertex];
         }
 
-        std::vector<IncidenceList> &GetIncidenceLists() {
-            return incidence_lists_;
+        size_t GetArcsEnd(VertexId vertex) const {
+            return arc_offsets_[vertex + 1];
         }
 
-        void Deserialize(const transport_catalogue_protobuf::Graph &proto_graph) {
-
-            edges_.clear();
-            edges_.reserve(proto_graph.edges_size());
-            for (const auto &proto_edge: proto_graph.edges()) {
-                edges_.emplace_back(Edge<Weight>{proto_edge.from(), proto_edge.to(), proto_edge.weight()});
-            }
-
-            incidence_lists_.clear();
-            incidence_lists_.resize(proto_graph.incidence_lists_size());
-            auto incidence_lists_it = incidence_lists_.begin();
+        EdgeId GetArcEdge(size_t arc) const {
+            return arc_edges_[arc];
+        }
 
-            for (const auto &proto_incident_list: proto_graph.incidence_lists()) {
-                *incidence_lists_it = std::vector<graph::EdgeId>(proto_incident_list.values_size());
-                for (const auto &value: proto_incident_list.values()) {
-                    incidence_lists_it->emplace_back(value);
-                }
-                ++incidence_lists_it;
-            }
+        VertexId GetArcTarget(size_t arc) const {
+            return arc_targets_[arc];
         }
 
-        transport_catalogue_protobuf::Graph Serialize() const {
-            transport_catalogue_protobuf::Graph proto_graph;
-            for (const auto &edge: edges_) {
-                transport_catalogue_protobuf::Edge proto_edge;
-                proto_edge.set_from(edge.from);
-                proto_edge.set_to(edge.to);
-                proto_edge.set_weight(edge.weight);
-                *proto_graph.add_edges() = std::move(proto_edge);
-            }
+        Weight GetArcWeight(size_t arc) const {
+            return arc_weights_[arc];
+        }
 
-            for (const auto &incidence_list: incidence_lists_) {
-                transport_catalogue_protobuf::IncidenceList proto_incidence_list;
-                for (const auto &incidence: incidence_list) {
-                    proto_incidence_list.add_values(incidence);
-                }
-                *proto_graph.add_incidence_lists() = std::move(proto_incidence_list);
-            }
+        void Deserialize(const transport_catalogue_protobuf::Graph &proto_graph);
 
-            return proto_graph;
-        }
+        transport_catalogue_protobuf::Graph Serialize() const;
 
     private:
+        static constexpr size_t MAX_COUNT = std::numeric_limits<uint32_t>::max();
+
+        // Начала рёбер и позиции рёбер в массивах CSR по номеру ребра
+        void IndexEdges();
+
+        // Загруженные массивы CSR должны быть согласованы, иначе IndexEdges писал бы за их границами:
+        // смещения не убывают и кончаются на числе дуг, концы — вершины графа, каждый номер ребра
+        // встречается ровно один раз
+        void CheckArcs() const;
+
+        size_t vertex_count_ = 0;
+        bool is_frozen_ = false;
+        // До Freeze()
         std::vector<Edge<Weight>> edges_;
         std::vector<IncidenceList> incidence_lists_;
+
+        // После Freeze()
+        std::vector<uint32_t> arc_offsets_;
+        std::vector<uint32_t> arc_edges_;
+        std::vector<uint32_t> arc_targets_;
+        std::vector<Weight> arc_weights_;
+        std::vector<uint32_t> edge_froms_;
+        std::vector<uint32_t> edge_arcs_;
     };
 
     template<typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-            : incidence_lists_(vertex_count) {
+            : vertex_count_(vertex_count), incidence_lists_(vertex_count) {
+        if (vertex_count >= MAX_COUNT) {
+            throw std::length_error("Too many vertices in graph");
+        }
+    }
+
+    template<typename Weight>
+    DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count, std::vector<Edge<Weight>> edges)
+            : vertex_count_(vertex_count), edges_(std::move(edges)) {
+        if (vertex_count >= MAX_COUNT) {
+            throw std::length_error("Too many vertices in graph");
+        }
+        for (const auto &edge: edges_) {
+            if (edge.from >= vertex_count_ || edge.to >= vertex_count_) {
+                throw std::out_of_range("Edge vertex is out of range");
+            }
+        }
+        Freeze();
     }
 
     template<typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight> &edge) {
+        if (is_frozen_) {
+            throw std::logic_error("Can't add edge to frozen graph");
+        }
+        if (edges_.size() >= MAX_COUNT) {
+            throw std::length_error("Too many edges in graph");
+        }
         edges_.push_back(edge);
         const EdgeId id = edges_.size() - 1;
-        incidence_lists_.at(edge.from).push_back(id);
+        incidence_lists_.at(edge.from).push_back(static_cast<uint32_t>(id));
         return id;
     }
 
+    template<typename Weight>
+    void DirectedWeightedGraph<Weight>::Freeze() {
+        if (is_frozen_) {
+            return;
+        }
+        if (edges_.size() >= MAX_COUNT) {
+            throw std::length_error("Too many edges in graph");
+        }
+
+        arc_offsets_.assign(vertex_count_ + 1, 0);
+        for (const auto &edge: edges_) {
+            ++arc_offsets_[edge.from + 1];
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            arc_offsets_[vertex + 1] += arc_offsets_[vertex];
+        }
+
+        // Рёбра раскладываются по вершинам в порядке номеров — порядок обхода тот же, что у списков смежности
+        arc_edges_.resize(edges_.size());
+        arc_targets_.resize(edges_.size());
+        arc_weights_.resize(edges_.size());
+        std::vector<uint32_t> positions(arc_offsets_.begin(), std::prev(arc_offsets_.end()));
+        for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+            const auto &edge = edges_[edge_id];
+            const uint32_t arc = positions[edge.from]++;
+            arc_edges_[arc] = static_cast<uint32_t>(edge_id);
+            arc_targets_[arc] = static_cast<uint32_t>(edge.to);
+            arc_weights_[arc] = edge.weight;
+        }
+
+        std::vector<Edge<Weight>>().swap(edges_);
+        std::vector<IncidenceList>().swap(incidence_lists_);
+        IndexEdges();
+        is_frozen_ = true;
+    }
+
+    template<typename Weight>
+    void DirectedWeightedGraph<Weight>::IndexEdges() {
+        edge_froms_.resize(arc_edges_.size());
+        edge_arcs_.resize(arc_edges_.size());
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            for (size_t arc = GetArcsBegin(vertex); arc < GetArcsEnd(vertex); ++arc) {
+                edge_froms_[arc_edges_[arc]] = static_cast<uint32_t>(vertex);
+                edge_arcs_[arc_edges_[arc]] = static_cast<uint32_t>(arc);
+            }
+        }
+    }
+
+    template<typename Weight>
+    void DirectedWeightedGraph<Weight>::CheckArcs() const {
+        const size_t arc_count = arc_edges_.size();
+        if (arc_targets_.size() != arc_count || arc_weights_.size() != arc_count || arc_count >= MAX_COUNT
+            || vertex_count_ >= MAX_COUNT) {
+            throw std::runtime_error("Graph arrays don't match each other, rebuild the base");
+        }
+        if (arc_offsets_.empty() ? arc_count != 0
+                                 : arc_offsets_.front() != 0 || arc_offsets_.back() != arc_count
+                                   || !std::is_sorted(arc_offsets_.begin(), arc_offsets_.end())) {
+            throw std::runtime_error("Graph offsets don't match its arcs, rebuild the base");
+        }
+        if (std::any_of(arc_targets_.begin(), arc_targets_.end(),
+                        [this](uint32_t target) { return target >= vertex_count_; })) {
+            throw std::runtime_error("Graph arc leads to a missing vertex, rebuild the base");
+        }
+        std::vector<bool> is_seen(arc_count, false);
+        for (const uint32_t edge_id: arc_edges_) {
+            if (edge_id >= arc_count || is_seen[edge_id]) {
+                throw std::runtime_error("Graph edge ids should be a permutation of arcs, rebuild the base");
+            }
+            is_seen[edge_id] = true;
+        }
+    }
+
+    template<typename Weight>
+    void DirectedWeightedGraph<Weight>::Deserialize(const transport_catalogue_protobuf::Graph &proto_graph) {
+        arc_offsets_.assign(proto_graph.offsets().begin(), proto_graph.offsets().end());
+        arc_edges_.assign(proto_graph.edge_ids().begin(), proto_graph.edge_ids().end());
+        arc_targets_.assign(proto_graph.targets().begin(), proto_graph.targets().end());
+        if constexpr (std::is_integral_v<Weight>) {
+            arc_weights_.assign(proto_graph.integer_weights().begin(), proto_graph.integer_weights().end());
+        } else {
+            arc_weights_.assign(proto_graph.weights().begin(), proto_graph.weights().end());
+        }
+
+        vertex_count_ = arc_offsets_.empty() ? 0 : arc_offsets_.size() - 1;
+        edges_.clear();
+        incidence_lists_.clear();
+        CheckArcs();
+        IndexEdges();
+        is_frozen_ = true;
+    }
+
+    template<typename Weight>
+    transport_catalogue_protobuf::Graph DirectedWeightedGraph<Weight>::Serialize() const {
+        if (!is_frozen_) {
+            throw std::logic_error("Only frozen graph can be serialized");
+        }
+
+        transport_catalogue_protobuf::Graph proto_graph;
+        proto_graph.mutable_offsets()->Add(arc_offsets_.begin(), arc_offsets_.end());
+        proto_graph.mutable_edge_ids()->Add(arc_edges_.begin(), arc_edges_.end());
+        proto_graph.mutable_targets()->Add(arc_targets_.begin(), arc_targets_.end());
+        if constexpr (std::is_integral_v<Weight>) {
+            proto_graph.mutable_integer_weights()->Add(arc_weights_.begin(), arc_weights_.end());
+        } else {
+            proto_graph.mutable_weights()->Add(arc_weights_.begin(), arc_weights_.end());
+        }
+        return proto_graph;
+    }
+
     template<typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-        return incidence_lists_.size();
+        return vertex_count_;
     }
 
     template<typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const {
-        return edges_.size();
+        return is_frozen_ ? arc_edges_.size() : edges_.size();
     }
 
     template<typename Weight>
-    const Edge<Weight> &DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-        return edges_.at(edge_id);
+    Edge<Weight> DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
+        if (!is_frozen_) {
+            return edges_[edge_id];
+        }
+        const uint32_t arc = edge_arcs_[edge_id];
+        return {edge_froms_[edge_id], arc_targets_[arc], arc_weights_[arc]};
     }
 
     template<typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
     DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-        return ranges::AsRange(incidence_lists_.at(vertex));
+        if (is_frozen_) {
+            return {arc_edges_.data() + GetArcsBegin(vertex), arc_edges_.data() + GetArcsEnd(vertex)};
+        }
+        const auto &incidence_list = incidence_lists_[vertex];
+        return {incidence_list.data(), incidence_list.data() + incidence_list.size()};
     }
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
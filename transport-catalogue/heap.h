@@ -0,0 +1,139 @@
+#pragma once
+
+#include "graph.h"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+    // Двоичная куча с "ленивым" удалением: устаревшие элементы не удаляются,
+    // а пропускаются при извлечении. Буфер переиспользуется между запросами.
+    template<typename Weight>
+    class BinaryHeap {
+    public:
+        using Item = std::pair<Weight, VertexId>;
+
+        void Push(Weight weight, VertexId vertex) {
+            items_.emplace_back(weight, vertex);
+            std::push_heap(items_.begin(), items_.end(), std::greater<>{});
+        }
+
+        Item Pop() {
+            std::pop_heap(items_.begin(), items_.end(), std::greater<>{});
+            Item item = items_.back();
+            items_.pop_back();
+            return item;
+        }
+
+        const Item &Top() const {
+            return items_.front();
+        }
+
+        bool Empty() const {
+            return items_.empty();
+        }
+
+        void Clear() {
+            items_.clear();
+        }
+
+    private:
+        std::vector<Item> items_;
+    };
+
+    // Радиксная куча для целых беззнаковых весов. Годится для поиска Дейкстры, где новый ключ
+    // не меньше последнего извлечённого: элемент лежит в корзине по номеру старшего бита, которым
+    // он отличается от последнего извлечённого ключа, и за всё время опускается не более чем
+    // через разрядность весов корзин — без сравнений внутри кучи.
+    template<typename Weight>
+    class RadixHeap {
+        static_assert(std::is_integral_v<Weight> && std::is_unsigned_v<Weight>,
+                      "RadixHeap requires unsigned integer weights");
+
+    public:
+        using Item = std::pair<Weight, VertexId>;
+
+        void Push(Weight weight, VertexId vertex) {
+            buckets_[GetBucket(weight)].emplace_back(weight, vertex);
+            ++size_;
+        }
+
+        Item Pop() {
+            Refill();
+            Item item = buckets_[0].back();
+            buckets_[0].pop_back();
+            --size_;
+            return item;
+        }
+
+        const Item &Top() const {
+            Refill();
+            return buckets_[0].back();
+        }
+
+        bool Empty() const {
+            return size_ == 0;
+        }
+
+        void Clear() {
+            for (auto &bucket: buckets_) {
+                bucket.clear();
+            }
+            last_ = 0;
+            size_ = 0;
+        }
+
+    private:
+        static constexpr size_t BUCKET_COUNT = std::numeric_limits<Weight>::digits + 1;
+
+        size_t GetBucket(Weight weight) const {
+            const unsigned long long diff = weight ^ last_;
+            if (diff == 0) {
+                return 0;
+            }
+#if defined(__GNUC__)
+            return std::numeric_limits<unsigned long long>::digits - __builtin_clzll(diff);
+#else
+            size_t bucket = 0;
+            for (auto rest = diff; rest != 0; rest >>= 1) {
+                ++bucket;
+            }
+            return bucket;
+#endif
+        }
+
+        // Когда корзина 0 пуста, минимум первой непустой корзины становится последним ключом,
+        // и её элементы расходятся по младшим корзинам
+        void Refill() const {
+            if (!buckets_[0].empty()) {
+                return;
+            }
+            size_t bucket = 1;
+            while (buckets_[bucket].empty()) {
+                ++bucket;
+            }
+            auto &items = buckets_[bucket];
+            last_ = std::min_element(items.begin(), items.end())->first;
+            for (const auto &item: items) {
+                buckets_[GetBucket(item.first)].push_back(item);
+            }
+            items.clear();
+        }
+
+        mutable std::array<std::vector<Item>, BUCKET_COUNT> buckets_;
+        mutable Weight last_ = 0;
+        size_t size_ = 0;
+    };
+
+    // Куча для поиска Дейкстры: радиксная для беззнаковых целых весов, двоичная для остальных
+    template<typename Weight>
+    using DijkstraHeap = std::conditional_t<std::is_integral_v<Weight> && std::is_unsigned_v<Weight>,
+                                            RadixHeap<Weight>, BinaryHeap<Weight>>;
+
+}  // namespace graph
@@ -0,0 +1,377 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "search_state.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <transport_router.pb.h>
+
+namespace graph {
+
+    // Метки хабов (hub labeling). У вершины v есть исходящая метка — хабы h с весом пути v → h —
+    // и входящая — хабы h с весом пути h → v. Метки строятся отсечёнными поисками Дейкстры
+    // (pruned landmark labeling) от вершин в порядке убывания важности, поэтому хабы в метке
+    // отсортированы по номеру, и запрос — слияние двух отсортированных списков без поиска по графу.
+    // Для каждой записи хранится ребро пути к хабу: по нему маршрут восстанавливается по меткам соседей.
+    template<typename Weight>
+    class HubLabels final : public RouteBuilder<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using RouteInfo = typename RouteBuilder<Weight>::RouteInfo;
+
+        // ranks — важность вершин, например ранги иерархии сжатий: чем больше ранг, тем раньше вершина
+        // становится хабом
+        HubLabels(const Graph &graph, const std::vector<uint32_t> &ranks);
+
+        HubLabels(const Graph &graph, const transport_catalogue_protobuf::HubLabels &proto_hub_labels);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        std::optional<Weight> GetRouteWeight(VertexId from, VertexId to) const override;
+
+        void Deserialize(const transport_catalogue_protobuf::HubLabels &proto_hub_labels);
+
+        transport_catalogue_protobuf::HubLabels Serialize() const;
+
+    private:
+        using Hub = uint32_t;
+        using LabelEdge = uint32_t;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+                                                     ? std::numeric_limits<Weight>::infinity()
+                                                     : std::numeric_limits<Weight>::max();
+        static constexpr LabelEdge NO_LABEL_EDGE = std::numeric_limits<LabelEdge>::max();
+
+        // Метки всех вершин плоскими массивами: записи вершины v — [offsets[v], offsets[v + 1])
+        struct LabelSet {
+            std::vector<size_t> offsets;
+            std::vector<Hub> hubs;
+            std::vector<Weight> weights;
+            std::vector<LabelEdge> edges;
+
+            // Позиция записи хаба hub в метке вершины vertex; запись обязана быть
+            size_t Find(VertexId vertex, Hub hub) const {
+                const auto begin = hubs.begin() + offsets[vertex];
+                const auto end = hubs.begin() + offsets[vertex + 1];
+                return std::lower_bound(begin, end, hub) - hubs.begin();
+            }
+
+            void Deserialize(const transport_catalogue_protobuf::HubLabelSet &proto_label_set);
+
+            transport_catalogue_protobuf::HubLabelSet Serialize() const;
+
+            // Загруженные метки должны подходить к графу: смещения неубывающие и кончаются на числе записей,
+            // хабы — вершины графа, рёбра — его рёбра
+            bool IsValid(size_t vertex_count, size_t edge_count) const;
+        };
+
+        struct LabelEntry {
+            Hub hub{};
+            Weight weight{};
+            LabelEdge edge{};
+        };
+
+        // Лучший общий хаб метки from и метки to: позиции записей в out_labels_ и in_labels_
+        std::optional<std::pair<size_t, size_t>> FindBestHub(VertexId from, VertexId to) const;
+
+        void BuildLabels(const std::vector<uint32_t> &ranks);
+
+        static LabelSet Flatten(const std::vector<std::vector<LabelEntry>> &labels);
+
+        static SearchState<Weight> &GetSearchState() {
+            static thread_local SearchState<Weight> state;
+            return state;
+        }
+
+        const Graph &graph_;
+        LabelSet out_labels_;
+        LabelSet in_labels_;
+    };
+
+    template<typename Weight>
+    HubLabels<Weight>::HubLabels(const Graph &graph, const std::vector<uint32_t> &ranks) : graph_(graph) {
+        if (!graph.IsFrozen()) {
+            throw std::logic_error("Graph should be frozen before routing");
+        }
+        if (ranks.size() != graph.GetVertexCount()) {
+            throw std::logic_error("Ranks should be set for every vertex");
+        }
+        if (graph.GetEdgeCount() >= NO_LABEL_EDGE) {
+            throw std::length_error("Too many edges for hub labels");
+        }
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        BuildLabels(ranks);
+    }
+
+    template<typename Weight>
+    HubLabels<Weight>::HubLabels(const Graph &graph, const transport_catalogue_protobuf::HubLabels &proto_hub_labels)
+            : graph_(graph) {
+        Deserialize(proto_hub_labels);
+    }
+
+    template<typename Weight>
+    void HubLabels<Weight>::BuildLabels(const std::vector<uint32_t> &ranks) {
+        const size_t vertex_count = graph_.GetVertexCount();
+
+        std::vector<VertexId> order(vertex_count);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&ranks](VertexId lhs, VertexId rhs) {
+            return ranks[lhs] > ranks[rhs];
+        });
+
+        // Обратные рёбра для поисков к хабу
+        std::vector<size_t> in_offsets(vertex_count + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            ++in_offsets[graph_.GetEdge(edge_id).to + 1];
+        }
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            in_offsets[vertex + 1] += in_offsets[vertex];
+        }
+        std::vector<EdgeId> in_edges(graph_.GetEdgeCount());
+        std::vector<size_t> positions(in_offsets.begin(), std::prev(in_offsets.end()));
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            in_edges[positions[graph_.GetEdge(edge_id).to]++] = edge_id;
+        }
+
+        std::vector<std::vector<LabelEntry>> out_labels(vertex_count);
+        std::vector<std::vector<LabelEntry>> in_labels(vertex_count);
+        std::vector<Weight> hub_weights(vertex_count, UNREACHABLE_WEIGHT);
+        auto &state = GetSearchState();
+
+        // Поиск от хаба (is_forward) или к хабу. Вершина отсекается, если путь через уже построенные
+        // метки не длиннее найденного: тогда она и всё, что за ней, покрыто более важными хабами
+        auto search = [&](Hub hub, bool is_forward) {
+            const VertexId hub_vertex = order[hub];
+            const auto &hub_label = is_forward ? out_labels[hub_vertex] : in_labels[hub_vertex];
+            auto &labels = is_forward ? in_labels : out_labels;
+
+            for (const auto &entry: hub_label) {
+                hub_weights[entry.hub] = entry.weight;
+            }
+
+            state.Reset(vertex_count);
+            state.Reach(hub_vertex, ZERO_WEIGHT, NO_EDGE);
+            while (!state.heap.Empty()) {
+                const auto [weight, vertex] = state.heap.Pop();
+                if (state.weights[vertex] < weight) {
+                    continue;
+                }
+
+                bool is_covered = false;
+                for (const auto &entry: labels[vertex]) {
+                    if (hub_weights[entry.hub] != UNREACHABLE_WEIGHT &&
+                        !(weight < hub_weights[entry.hub] + entry.weight)) {
+                        is_covered = true;
+                        break;
+                    }
+                }
+                if (is_covered) {
+                    continue;
+                }
+
+                const EdgeId prev_edge = state.prev_edges[vertex];
+                labels[vertex].push_back({hub, weight, prev_edge == NO_EDGE ? NO_LABEL_EDGE
+                                                                            : static_cast<LabelEdge>(prev_edge)});
+
+                if (is_forward) {
+                    for (size_t arc = graph_.GetArcsBegin(vertex); arc < graph_.GetArcsEnd(vertex); ++arc) {
+                        const VertexId target = graph_.GetArcTarget(arc);
+                        const Weight candidate_weight = weight + graph_.GetArcWeight(arc);
+                        if (!state.IsReached(target) || candidate_weight < state.weights[target]) {
+                            state.Reach(target, candidate_weight, graph_.GetArcEdge(arc));
+                        }
+                    }
+                } else {
+                    for (size_t i = in_offsets[vertex]; i < in_offsets[vertex + 1]; ++i) {
+                        const auto &edge = graph_.GetEdge(in_edges[i]);
+                        const Weight candidate_weight = weight + edge.weight;
+                        if (!state.IsReached(edge.from) || candidate_weight < state.weights[edge.from]) {
+                            state.Reach(edge.from, candidate_weight, in_edges[i]);
+                        }
+                    }
+                }
+            }
+
+            for (const auto &entry: hub_label) {
+                hub_weights[entry.hub] = UNREACHABLE_WEIGHT;
+            }
+        };
+
+        for (Hub hub = 0; hub < vertex_count; ++hub) {
+            search(hub, true);
+            search(hub, false);
+        }
+
+        out_labels_ = Flatten(out_labels);
+        in_labels_ = Flatten(in_labels);
+    }
+
+    template<typename Weight>
+    typename HubLabels<Weight>::LabelSet
+    HubLabels<Weight>::Flatten(const std::vector<std::vector<LabelEntry>> &labels) {
+        LabelSet label_set;
+        label_set.offsets.reserve(labels.size() + 1);
+        label_set.offsets.push_back(0);
+        for (const auto &label: labels) {
+            label_set.offsets.push_back(label_set.offsets.back() + label.size());
+        }
+
+        label_set.hubs.reserve(label_set.offsets.back());
+        label_set.weights.reserve(label_set.offsets.back());
+        label_set.edges.reserve(label_set.offsets.back());
+        for (const auto &label: labels) {
+            for (const auto &entry: label) {
+                label_set.hubs.push_back(entry.hub);
+                label_set.weights.push_back(entry.weight);
+                label_set.edges.push_back(entry.edge);
+            }
+        }
+        return label_set;
+    }
+
+    template<typename Weight>
+    std::optional<std::pair<size_t, size_t>> HubLabels<Weight>::FindBestHub(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            return std::nullopt;
+        }
+
+        std::optional<std::pair<size_t, size_t>> best_hub;
+        Weight best_weight = UNREACHABLE_WEIGHT;
+        size_t out_position = out_labels_.offsets[from];
+        size_t in_position = in_labels_.offsets[to];
+        const size_t out_end = out_labels_.offsets[from + 1];
+        const size_t in_end = in_labels_.offsets[to + 1];
+        while (out_position < out_end && in_position < in_end) {
+            const Hub out_hub = out_labels_.hubs[out_position];
+            const Hub in_hub = in_labels_.hubs[in_position];
+            if (out_hub < in_hub) {
+                ++out_position;
+            } else if (in_hub < out_hub) {
+                ++in_position;
+            } else {
+                const Weight weight = out_labels_.weights[out_position] + in_labels_.weights[in_position];
+                if (!best_hub || weight < best_weight) {
+                    best_hub = {out_position, in_position};
+                    best_weight = weight;
+                }
+                ++out_position;
+                ++in_position;
+            }
+        }
+        return best_hub;
+    }
+
+    template<typename Weight>
+    std::optional<Weight> HubLabels<Weight>::GetRouteWeight(VertexId from, VertexId to) const {
+        const auto best_hub = FindBestHub(from, to);
+        if (!best_hub) {
+            return std::nullopt;
+        }
+        return out_labels_.weights[best_hub->first] + in_labels_.weights[best_hub->second];
+    }
+
+    template<typename Weight>
+    std::optional<typename HubLabels<Weight>::RouteInfo> HubLabels<Weight>::BuildRoute(VertexId from,
+                                                                                     VertexId to) const {
+        const auto best_hub = FindBestHub(from, to);
+        if (!best_hub) {
+            return std::nullopt;
+        }
+        const auto [out_position, in_position] = *best_hub;
+        const Hub hub = out_labels_.hubs[out_position];
+
+        // Путь до хаба: ребро записи ведёт к соседу, в метке которого есть запись того же хаба
+        std::vector<EdgeId> edges;
+        for (size_t position = out_position; out_labels_.edges[position] != NO_LABEL_EDGE;) {
+            const EdgeId edge_id = out_labels_.edges[position];
+            edges.push_back(edge_id);
+            position = out_labels_.Find(graph_.GetEdge(edge_id).to, hub);
+        }
+
+        const size_t hub_path_begin = edges.size();
+        for (size_t position = in_position; in_labels_.edges[position] != NO_LABEL_EDGE;) {
+            const EdgeId edge_id = in_labels_.edges[position];
+            edges.push_back(edge_id);
+            position = in_labels_.Find(graph_.GetEdge(edge_id).from, hub);
+        }
+        std::reverse(edges.begin() + hub_path_begin, edges.end());
+
+        return RouteInfo{out_labels_.weights[out_position] + in_labels_.weights[in_position], std::move(edges)};
+    }
+
+    template<typename Weight>
+    void HubLabels<Weight>::LabelSet::Deserialize(const transport_catalogue_protobuf::HubLabelSet &proto_label_set) {
+        offsets.assign(proto_label_set.offsets().begin(), proto_label_set.offsets().end());
+        hubs.assign(proto_label_set.hubs().begin(), proto_label_set.hubs().end());
+        if constexpr (std::is_integral_v<Weight>) {
+            weights.assign(proto_label_set.integer_weights().begin(), proto_label_set.integer_weights().end());
+        } else {
+            weights.assign(proto_label_set.weights().begin(), proto_label_set.weights().end());
+        }
+        edges.assign(proto_label_set.edges().begin(), proto_label_set.edges().end());
+    }
+
+    template<typename Weight>
+    bool HubLabels<Weight>::LabelSet::IsValid(size_t vertex_count, size_t edge_count) const {
+        if (offsets.size() != vertex_count + 1 || offsets.front() != 0 || offsets.back() != hubs.size()
+            || weights.size() != hubs.size() || edges.size() != hubs.size()
+            || !std::is_sorted(offsets.begin(), offsets.end())) {
+            return false;
+        }
+        return std::all_of(hubs.begin(), hubs.end(), [vertex_count](Hub hub) { return hub < vertex_count; })
+               && std::all_of(edges.begin(), edges.end(), [edge_count](LabelEdge edge) {
+                   return edge == NO_LABEL_EDGE || edge < edge_count;
+               });
+    }
+
+    template<typename Weight>
+    transport_catalogue_protobuf::HubLabelSet HubLabels<Weight>::LabelSet::Serialize() const {
+        transport_catalogue_protobuf::HubLabelSet proto_label_set;
+        proto_label_set.mutable_offsets()->Add(offsets.begin(), offsets.end());
+        proto_label_set.mutable_hubs()->Add(hubs.begin(), hubs.end());
+        if constexpr (std::is_integral_v<Weight>) {
+            proto_label_set.mutable_integer_weights()->Add(weights.begin(), weights.end());
+        } else {
+            proto_label_set.mutable_weights()->Add(weights.begin(), weights.end());
+        }
+        proto_label_set.mutable_edges()->Add(edges.begin(), edges.end());
+        return proto_label_set;
+    }
+
+    template<typename Weight>
+    void HubLabels<Weight>::Deserialize(const transport_catalogue_protobuf::HubLabels &proto_hub_labels) {
+        out_labels_.Deserialize(proto_hub_labels.out_labels());
+        in_labels_.Deserialize(proto_hub_labels.in_labels());
+        if (!out_labels_.IsValid(graph_.GetVertexCount(), graph_.GetEdgeCount()) ||
+            !in_labels_.IsValid(graph_.GetVertexCount(), graph_.GetEdgeCount())) {
+            throw std::runtime_error("Hub labels don't match the graph, rebuild the base");
+        }
+    }
+
+    template<typename Weight>
+    transport_catalogue_protobuf::HubLabels HubLabels<Weight>::Serialize() const {
+        transport_catalogue_protobuf::HubLabels proto_hub_labels;
+        *proto_hub_labels.mutable_out_labels() = out_labels_.Serialize();
+        *proto_hub_labels.mutable_in_labels() = in_labels_.Serialize();
+        return proto_hub_labels;
+    }
+
+}  // namespace graph
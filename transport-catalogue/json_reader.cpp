@@ -1,4 +1,6 @@
 #include "json_reader.h"
+#include <algorithm>
+#include <limits>
 #include <unordered_set>
 
 /*
@@ -73,6 +75,11 @@ namespace transport_catalogue {
 
         for (const auto bus_jnode: base_bus_requests_) {
             const auto &bus_map = bus_jnode->AsDict();
+            if (const auto removed_it = bus_map.find("removed"s);
+                    removed_it != bus_map.end() && removed_it->second.AsBool()) {
+                removed_bus_names_.push_back(bus_map.at("name"s).AsString());
+                continue;
+            }
             InputBusInfo bus_info{bus_map.at("name"s).AsString(), {}};
 
             std::vector<std::string> stops_vec;
@@ -83,6 +90,12 @@ namespace transport_catalogue {
             std::deque<std::string> stops_v_deque{stops_vec.begin(), stops_vec.end()};
             bus_info.is_circled = bus_map.at("is_roundtrip"s).AsBool();
             bus_info.stops = std::move(stops_v_deque);
+            if (const auto departures_it = bus_map.find("departures"s); departures_it != bus_map.end()) {
+                for (const auto &departure: departures_it->second.AsArray()) {
+                    bus_info.departures.push_back(departure.AsDouble());
+                }
+                std::sort(bus_info.departures.begin(), bus_info.departures.end());
+            }
             parsed_bus_info_deque_.emplace_back(std::move(bus_info));
         }
 
@@ -197,6 +210,24 @@ namespace transport_catalogue {
             if (key == "bus_velocity"s) {
                 t_router_.SetBusVelocity(value.AsDouble());
             }
+            if (key == "router_engine"s) {
+                t_router_.SetRouterEngine(ParseRouterEngine(value.AsString()));
+            }
+            if (key == "build_threads"s) {
+                t_router_.SetBuildThreads(value.AsInt());
+            }
+            if (key == "graph_build_threads"s) {
+                t_router_.SetGraphBuildThreads(value.AsInt());
+            }
+            if (key == "graph_model"s) {
+                t_router_.SetGraphModel(ParseGraphModel(value.AsString()));
+            }
+            if (key == "route_table_format"s) {
+                t_router_.SetRouteTableFormat(ParseRouteTableFormat(value.AsString()));
+            }
+            if (key == "route_cache_bytes"s) {
+                t_router_.SetRouteCacheBytes(value.AsDouble());
+            }
         }
     }
 
@@ -222,10 +253,33 @@ namespace transport_catalogue {
             db_.AddRealDistance(&dist);
         }
 
+        db_.Freeze();
         t_router_.SetDb(db_);
         t_router_.FillGraph();
     }
 
+    void JsonRequestProcessor::PushBaseUpdate() {
+
+        for (const auto &stop: parsed_stop_info_deque_) {
+            db_.UpdateStop(&stop);
+        }
+
+        for (const auto &bus: parsed_bus_info_deque_) {
+            db_.UpdateBus(&bus);
+        }
+
+        for (const auto &bus_name: removed_bus_names_) {
+            db_.RemoveBus(bus_name);
+        }
+
+        for (const auto &dist: parsed_distance_info_deque_) {
+            db_.AddRealDistance(&dist);
+        }
+
+        db_.Freeze();
+        t_router_.UpdateDb(db_);
+    }
+
     std::string JsonRequestProcessor::PushStatRequests() {
 
         Array arr;
@@ -258,8 +312,8 @@ namespace transport_catalogue {
                 if (res) {
                     const auto &res_val = res.value();
                     Array bus_arr;
-                    for (const auto &bus: res_val.buses) {
-                        bus_arr.emplace_back(bus->bus_name);
+                    for (const auto bus_id: res_val.buses) {
+                        bus_arr.emplace_back(std::string(db_.GetBusName(bus_id)));
                     }
                     arr.emplace_back(json::Builder{}.StartDict()
                                              .Key("request_id"s).Value(stat_map.at("id").AsInt())
@@ -282,7 +336,11 @@ namespace transport_catalogue {
                 const auto from = stat_map.at("from"s).AsString();
                 const auto to = stat_map.at("to"s).AsString();
 
-                auto res = t_router_.GetRoute(from, to);
+                // С моментом отправления маршрут ищется по расписанию автобусов
+                const auto departure_time_it = stat_map.find("departure_time"s);
+                auto res = departure_time_it != stat_map.end()
+                           ? t_router_.GetTimetableRoute(from, to, departure_time_it->second.AsDouble())
+                           : t_router_.GetRoute(from, to);
 
                 if (res) {
                     const auto &res_val = res.value();
@@ -295,7 +353,7 @@ namespace transport_catalogue {
                             const auto edge_data = std::get<BusItem>(val);
                             total_time += edge_data.time;
                             items.emplace_back(json::Builder{}.StartDict()
-                                                       .Key("bus"s).Value(edge_data.name.data())
+                                                       .Key("bus"s).Value(std::string(edge_data.name))
                                                        .Key("span_count"s).Value(edge_data.span)
                                                        .Key("time"s).Value(edge_data.time)
                                                        .Key("type"s).Value("Bus"s)
@@ -304,7 +362,7 @@ namespace transport_catalogue {
                             const auto edge_data = std::get<WaitItem>(val);
                             total_time += edge_data.time;
                             items.emplace_back(json::Builder{}.StartDict()
-                                                       .Key("stop_name"s).Value(edge_data.name.data())
+                                                       .Key("stop_name"s).Value(std::string(edge_data.name))
                                                        .Key("time"s).Value(edge_data.time)
                                                        .Key("type"s).Value("Wait"s)
                                                        .EndDict().Build().GetRoot());
@@ -323,6 +381,72 @@ namespace transport_catalogue {
                                              .Key("error_message"s).Value("not found"s)
                                              .EndDict().Build().GetRoot());
                 }
+            } else if (stat_map.at("type"s).AsString() == "Matrix"s) {
+                std::vector<std::string_view> from;
+                std::vector<std::string_view> to;
+                for (const auto &stop_node: stat_map.at("from"s).AsArray()) {
+                    from.emplace_back(stop_node.AsString());
+                }
+                for (const auto &stop_node: stat_map.at("to"s).AsArray()) {
+                    to.emplace_back(stop_node.AsString());
+                }
+
+                Array times;
+                times.reserve(from.size() * to.size());
+                for (const auto time: t_router_.GetTravelTimes(from, to)) {
+                    if (time) {
+                        times.emplace_back(*time);
+                    } else {
+                        times.emplace_back(nullptr);
+                    }
+                }
+                arr.emplace_back(json::Builder{}.StartDict()
+                                         .Key("request_id"s).Value(stat_map.at("id").AsInt())
+                                         .Key("times"s).Value(times)
+                                         .EndDict().Build().GetRoot());
+            } else if (stat_map.at("type"s).AsString() == "RouteCacheStats"s) {
+                if (const auto stats = t_router_.GetRouteCacheStats()) {
+                    // Счётчики выводятся целыми: double печатается с шестью значащими цифрами.
+                    // Больше INT_MAX значение не переполняется, а упирается в предел
+                    auto to_json_count = [](size_t count) {
+                        return static_cast<int>(std::min<size_t>(count, std::numeric_limits<int>::max()));
+                    };
+                    arr.emplace_back(json::Builder{}.StartDict()
+                                             .Key("request_id"s).Value(stat_map.at("id").AsInt())
+                                             .Key("hits"s).Value(to_json_count(stats->hits))
+                                             .Key("misses"s).Value(to_json_count(stats->misses))
+                                             .Key("rows"s).Value(to_json_count(stats->rows))
+                                             .Key("bytes"s).Value(to_json_count(stats->bytes))
+                                             .EndDict().Build().GetRoot());
+                } else {
+                    arr.emplace_back(json::Builder{}.StartDict()
+                                             .Key("request_id"s).Value(stat_map.at("id").AsInt())
+                                             .Key("error_message"s).Value("not found"s)
+                                             .EndDict().Build().GetRoot());
+                }
+            } else if (stat_map.at("type"s).AsString() == "Isochrone"s) {
+                auto res = t_router_.GetReachableStops(stat_map.at("from"s).AsString(),
+                                                       stat_map.at("max_time"s).AsDouble());
+
+                if (res) {
+                    Array stops;
+                    stops.reserve(res->size());
+                    for (const auto &reachable_stop: *res) {
+                        stops.emplace_back(json::Builder{}.StartDict()
+                                                   .Key("stop_name"s).Value(std::string(reachable_stop.name))
+                                                   .Key("time"s).Value(reachable_stop.time)
+                                                   .EndDict().Build().GetRoot());
+                    }
+                    arr.emplace_back(json::Builder{}.StartDict()
+                                             .Key("request_id"s).Value(stat_map.at("id").AsInt())
+                                             .Key("stops"s).Value(stops)
+                                             .EndDict().Build().GetRoot());
+                } else {
+                    arr.emplace_back(json::Builder{}.StartDict()
+                                             .Key("request_id"s).Value(stat_map.at("id").AsInt())
+                                             .Key("error_message"s).Value("not found"s)
+                                             .EndDict().Build().GetRoot());
+                }
             }
         }
 
@@ -39,6 +39,9 @@ namespace transport_catalogue {
 
         void PushBaseRequest();
 
+        // base_requests применяются как изменения к загруженной базе (режим update_base)
+        void PushBaseUpdate();
+
         void ParseRenderSettings(const json::Node &settings_node);
 
         void ParseRoutingSettings(const json::Node &settings_node);
@@ -67,6 +70,7 @@ namespace transport_catalogue {
         std::deque<transport_catalogue::InputStopInfo> parsed_stop_info_deque_;
         std::deque<transport_catalogue::InputBusInfo> parsed_bus_info_deque_;
         std::deque<transport_catalogue::InputDistanceInfo> parsed_distance_info_deque_;
+        std::deque<std::string> removed_bus_names_;
     };
 
 
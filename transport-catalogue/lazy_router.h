@@ -0,0 +1,202 @@
+#pragma once
+
+#include "graph.h"
+#include "heap.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace graph {
+
+    struct RouteCacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t rows = 0;
+        size_t bytes = 0;
+    };
+
+    // Строка таблицы маршрутов из вершины from: веса кратчайших путей до всех вершин и последние рёбра
+    // этих путей. До вызова вся строка должна быть помечена недостижимой (вес больше любого пути)
+    template<typename Weight, typename PrevEdge>
+    void FillDijkstraRow(const DirectedWeightedGraph<Weight> &graph, VertexId from,
+                         Weight *row_weights, PrevEdge *row_prev_edges, DijkstraHeap<Weight> &heap) {
+        heap.Clear();
+        row_weights[from] = Weight{};
+        heap.Push(Weight{}, from);
+
+        while (!heap.Empty()) {
+            const auto [weight, vertex] = heap.Pop();
+            if (row_weights[vertex] < weight) {
+                continue;
+            }
+            for (size_t arc = graph.GetArcsBegin(vertex); arc < graph.GetArcsEnd(vertex); ++arc) {
+                const VertexId target = graph.GetArcTarget(arc);
+                const Weight candidate_weight = weight + graph.GetArcWeight(arc);
+                if (candidate_weight < row_weights[target]) {
+                    row_weights[target] = candidate_weight;
+                    row_prev_edges[target] = static_cast<PrevEdge>(graph.GetArcEdge(arc));
+                    heap.Push(candidate_weight, target);
+                }
+            }
+        }
+    }
+
+    // Ленивая таблица маршрутов: строка источника — веса и последние рёбра путей до всех вершин —
+    // считается поиском Дейкстры при первом запросе из него и хранится в кэше LRU. В кэше строк
+    // не больше, чем помещается в cache_bytes (но хотя бы одна); вытесняется давно не нужная строка,
+    // и её буферы достаются новой. Таблица не строится заранее и не сохраняется в базу.
+    template<typename Weight>
+    class LazyRouter final : public RouteBuilder<Weight> {
+    private:
+        using Graph = DirectedWeightedGraph<Weight>;
+
+    public:
+        using RouteInfo = typename RouteBuilder<Weight>::RouteInfo;
+
+        LazyRouter(const Graph &graph, size_t cache_bytes);
+
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        std::optional<Weight> GetRouteWeight(VertexId from, VertexId to) const override;
+
+        RouteCacheStats GetCacheStats() const;
+
+    private:
+        using PrevEdge = uint32_t;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+                                                     ? std::numeric_limits<Weight>::infinity()
+                                                     : std::numeric_limits<Weight>::max();
+        static constexpr PrevEdge NO_PREV_EDGE = std::numeric_limits<PrevEdge>::max();
+
+        struct Row {
+            VertexId from{};
+            std::vector<Weight> weights;
+            std::vector<PrevEdge> prev_edges;
+        };
+
+        // Строка источника from, перемещённая в начало очереди LRU; вызывается под mutex_
+        const Row &GetRow(VertexId from) const;
+
+        void FillRow(Row &row) const;
+
+        size_t GetRowBytes() const {
+            return graph_.GetVertexCount() * (sizeof(Weight) + sizeof(PrevEdge));
+        }
+
+        const Graph &graph_;
+        size_t max_rows_ = 1;
+
+        // Начало списка — последняя запрошенная строка, конец — кандидат на вытеснение
+        mutable std::list<Row> rows_;
+        mutable std::unordered_map<VertexId, typename std::list<Row>::iterator> row_positions_;
+        mutable DijkstraHeap<Weight> heap_;
+        mutable size_t hits_ = 0;
+        mutable size_t misses_ = 0;
+        mutable std::mutex mutex_;
+    };
+
+    template<typename Weight>
+    LazyRouter<Weight>::LazyRouter(const Graph &graph, size_t cache_bytes) : graph_(graph) {
+        if (!graph.IsFrozen()) {
+            throw std::logic_error("Graph should be frozen before routing");
+        }
+        if (graph.GetEdgeCount() >= NO_PREV_EDGE) {
+            throw std::length_error("Too many edges for the route table");
+        }
+        for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+        max_rows_ = std::max<size_t>(1, cache_bytes / std::max<size_t>(1, GetRowBytes()));
+    }
+
+    template<typename Weight>
+    const typename LazyRouter<Weight>::Row &LazyRouter<Weight>::GetRow(VertexId from) const {
+        if (const auto position_it = row_positions_.find(from); position_it != row_positions_.end()) {
+            ++hits_;
+            rows_.splice(rows_.begin(), rows_, position_it->second);
+            return rows_.front();
+        }
+
+        ++misses_;
+        if (rows_.size() < max_rows_) {
+            rows_.emplace_front();
+        } else {
+            row_positions_.erase(rows_.back().from);
+            rows_.splice(rows_.begin(), rows_, std::prev(rows_.end()));
+        }
+        Row &row = rows_.front();
+        row.from = from;
+        FillRow(row);
+        row_positions_[from] = rows_.begin();
+        return row;
+    }
+
+    template<typename Weight>
+    void LazyRouter<Weight>::FillRow(Row &row) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        row.weights.assign(vertex_count, UNREACHABLE_WEIGHT);
+        row.prev_edges.assign(vertex_count, NO_PREV_EDGE);
+
+        FillDijkstraRow(graph_, row.from, row.weights.data(), row.prev_edges.data(), heap_);
+    }
+
+    template<typename Weight>
+    std::optional<typename LazyRouter<Weight>::RouteInfo> LazyRouter<Weight>::BuildRoute(VertexId from,
+                                                                                         VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            return std::nullopt;
+        }
+
+        std::lock_guard lock(mutex_);
+        const Row &row = GetRow(from);
+        if (row.weights[to] == UNREACHABLE_WEIGHT) {
+            return std::nullopt;
+        }
+
+        std::vector<EdgeId> edges;
+        for (PrevEdge edge_id = row.prev_edges[to];
+             edge_id != NO_PREV_EDGE;
+             edge_id = row.prev_edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
+        }
+        std::reverse(edges.begin(), edges.end());
+
+        return RouteInfo{row.weights[to], std::move(edges)};
+    }
+
+    template<typename Weight>
+    std::optional<Weight> LazyRouter<Weight>::GetRouteWeight(VertexId from, VertexId to) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (from >= vertex_count || to >= vertex_count) {
+            return std::nullopt;
+        }
+
+        std::lock_guard lock(mutex_);
+        const Weight weight = GetRow(from).weights[to];
+        if (weight == UNREACHABLE_WEIGHT) {
+            return std::nullopt;
+        }
+        return weight;
+    }
+
+    template<typename Weight>
+    RouteCacheStats LazyRouter<Weight>::GetCacheStats() const {
+        std::lock_guard lock(mutex_);
+        return {hits_, misses_, rows_.size(), rows_.size() * GetRowBytes()};
+    }
+
+}  // namespace graph
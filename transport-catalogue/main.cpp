@@ -10,7 +10,7 @@
 using namespace std::literals;
 
 void PrintUsage(std::ostream &stream = std::cerr) {
-    stream << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    stream << "Usage: transport_catalogue [make_base|update_base|process_requests]\n"sv;
 }
 
 int main(int argc, char *argv[]) {
@@ -64,6 +64,16 @@ int main(int argc, char *argv[]) {
         serializer.Serialize();
         // make base here
 
+    } else if (mode == "update_base"sv) {
+
+        // Изменения (base_requests) применяются к уже собранной базе; настройки маршрутизации берутся из неё
+        auto input_json = LoadJSONStream(std::cin);
+        PushInputJsonToRH(input_json, rh);
+        serializer.Deserialize();
+        rh.ParseBaseRequests();
+        rh.PushBaseUpdate();
+        serializer.Serialize();
+
     } else if (mode == "process_requests"sv) {
 
         auto input_json = LoadJSONStream(std::cin);
@@ -0,0 +1,111 @@
+#include "name_index.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace transport_catalogue {
+
+    uint64_t NameIndex::Hash(std::string_view name) {
+        uint64_t hash = 14695981039346656037ULL;
+        for (const char c: name) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    uint64_t NameIndex::Mix(uint64_t hash, uint64_t salt) {
+        uint64_t x = hash + (salt + 1) * 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    bool NameIndex::TryBuild(const std::vector<HashedName> &names) {
+        const size_t name_count = names.size();
+        displacements_.assign((name_count + BUCKET_SIZE - 1) / BUCKET_SIZE, 0);
+        slots_.assign(name_count, Slot{});
+
+        std::vector<uint64_t> keys(name_count);
+        std::vector<std::vector<uint32_t>> buckets(displacements_.size());
+        for (uint32_t i = 0; i < name_count; ++i) {
+            keys[i] = Mix(names[i].hash, seed_);
+            buckets[GetBucket(keys[i])].push_back(i);
+        }
+
+        // Большие корзины размещаются первыми, пока свободных ячеек много
+        std::vector<uint32_t> bucket_order(buckets.size());
+        for (uint32_t bucket = 0; bucket < buckets.size(); ++bucket) {
+            bucket_order[bucket] = bucket;
+        }
+        std::stable_sort(bucket_order.begin(), bucket_order.end(), [&buckets](uint32_t lhs, uint32_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        std::vector<size_t> slots;
+        for (const auto bucket: bucket_order) {
+            const auto &members = buckets[bucket];
+            if (members.empty()) {
+                break;
+            }
+
+            bool is_placed = false;
+            for (uint32_t displacement = 0; displacement < MAX_DISPLACEMENT && !is_placed; ++displacement) {
+                slots.clear();
+                is_placed = true;
+                for (const auto i: members) {
+                    const size_t slot = GetSlot(keys[i], displacement);
+                    if (slots_[slot].id != EMPTY_SLOT || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                        is_placed = false;
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+                if (is_placed) {
+                    displacements_[bucket] = displacement;
+                }
+            }
+            if (!is_placed) {
+                return false;
+            }
+
+            for (size_t j = 0; j < members.size(); ++j) {
+                slots_[slots[j]] = {keys[members[j]], names[members[j]].id};
+            }
+        }
+        return true;
+    }
+
+    transport_catalogue_protobuf::NameIndex NameIndex::Serialize() const {
+        transport_catalogue_protobuf::NameIndex proto_name_index;
+        proto_name_index.mutable_displacements()->Add(displacements_.begin(), displacements_.end());
+        for (const auto &slot: slots_) {
+            proto_name_index.add_slot_ids(slot.id);
+            proto_name_index.add_slot_keys(slot.key);
+        }
+        proto_name_index.set_seed(seed_);
+        proto_name_index.set_name_count(name_count_);
+        return proto_name_index;
+    }
+
+    void NameIndex::Deserialize(const transport_catalogue_protobuf::NameIndex &proto_name_index) {
+        displacements_.assign(proto_name_index.displacements().begin(), proto_name_index.displacements().end());
+        seed_ = proto_name_index.seed();
+        name_count_ = proto_name_index.name_count();
+        const auto &proto_slot_ids = proto_name_index.slot_ids();
+        const auto &proto_slot_keys = proto_name_index.slot_keys();
+        // В базах без ключей ячеек функция не загружается, и справочник строит её заново
+        if (proto_slot_keys.size() != proto_slot_ids.size()) {
+            Clear();
+            return;
+        }
+        slots_.resize(proto_slot_ids.size());
+        for (int slot = 0; slot < proto_slot_ids.size(); ++slot) {
+            slots_[slot] = {proto_slot_keys[slot], proto_slot_ids[slot]};
+        }
+        if (!slots_.empty() && displacements_.empty()) {
+            throw std::runtime_error("Name index has no buckets");
+        }
+    }
+
+}
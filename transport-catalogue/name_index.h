@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <transport_catalogue.pb.h>
+
+namespace transport_catalogue {
+
+    // Совершенная хеш-функция над неизменным набором названий (схема CHD): хеш названия перемешивается
+    // с зерном, по нему название попадает в корзину, а у корзины подобрано смещение, при котором все её
+    // названия ложатся в свободные ячейки. Функция минимальная: ячеек ровно столько, сколько названий.
+    // Последним одиночным корзинам остаётся по нескольку свободных ячеек, поэтому смещения перебираются
+    // до MAX_DISPLACEMENT; если какая-то корзина всё же не размещается, функция строится с другим зерном.
+    // Ячейка, как в прежней таблице с открытой адресацией, хранит полный ключ и номер названия: поиск —
+    // одно вычисление хеша, а строки сравниваются только при совпадении ключа.
+    // Сами названия лежат снаружи (в пуле строк справочника) и достаются через get_name(id).
+    // Функция строится в make_base и сохраняется в базу
+    class NameIndex {
+    public:
+        template<class GetName>
+        void Build(size_t name_count, GetName get_name);
+
+        template<class GetName>
+        std::optional<uint32_t> Find(std::string_view name, GetName get_name) const;
+
+        size_t GetNameCount() const {
+            return name_count_;
+        }
+
+        void Clear() {
+            displacements_.clear();
+            slots_.clear();
+            seed_ = 0;
+            name_count_ = 0;
+        }
+
+        transport_catalogue_protobuf::NameIndex Serialize() const;
+
+        void Deserialize(const transport_catalogue_protobuf::NameIndex &proto_name_index);
+
+    private:
+        static constexpr uint32_t EMPTY_SLOT = std::numeric_limits<uint32_t>::max();
+
+        struct Slot {
+            uint64_t key = 0;
+            uint32_t id = EMPTY_SLOT;
+        };
+        // Среднее число названий в корзине
+        static constexpr size_t BUCKET_SIZE = 4;
+        // Одиночной корзине при одной свободной ячейке из n нужно в среднем n попыток
+        static constexpr uint32_t MAX_DISPLACEMENT = 1 << 24;
+        static constexpr uint64_t MAX_SEED = 64;
+
+        // FNV-1a: хеш не зависит от стандартной библиотеки, раз функция сохраняется в базу
+        static uint64_t Hash(std::string_view name);
+
+        // Перемешивание splitmix64: у FNV-1a похожие названия различаются в основном младшими битами
+        static uint64_t Mix(uint64_t hash, uint64_t salt);
+
+        uint64_t GetKey(std::string_view name) const {
+            return Mix(Hash(name), seed_);
+        }
+
+        size_t GetBucket(uint64_t key) const {
+            return (key >> 32) % displacements_.size();
+        }
+
+        size_t GetSlot(uint64_t key, uint32_t displacement) const {
+            return Mix(key, displacement) % slots_.size();
+        }
+
+        struct HashedName {
+            uint64_t hash = 0;
+            uint32_t id = 0;
+
+            bool operator<(const HashedName &other) const {
+                return std::tie(hash, id) < std::tie(other.hash, other.id);
+            }
+        };
+
+        // Размещение всех корзин при зерне seed_; false — какой-то корзине не нашлось смещения
+        bool TryBuild(const std::vector<HashedName> &names);
+
+        std::vector<uint32_t> displacements_;
+        std::vector<Slot> slots_;
+        uint64_t seed_ = 0;
+        size_t name_count_ = 0;
+    };
+
+    template<class GetName>
+    void NameIndex::Build(size_t name_count, GetName get_name) {
+        Clear();
+        if (name_count == 0) {
+            return;
+        }
+
+        // Пары (хеш, номер), упорядоченные по хешу: одинаковые названия оказываются рядом. Как и прежний
+        // словарь названий, индекс из повторяющихся названий оставляет последнее добавленное
+        std::vector<HashedName> names(name_count);
+        for (uint32_t id = 0; id < name_count; ++id) {
+            names[id] = {Hash(get_name(id)), id};
+        }
+        std::sort(names.begin(), names.end());
+        auto unique_end = names.begin();
+        for (auto it = names.begin(); it != names.end(); ++it) {
+            if (unique_end != names.begin()) {
+                auto &last = *std::prev(unique_end);
+                if (last.hash == it->hash && get_name(last.id) == get_name(it->id)) {
+                    last.id = it->id;
+                    continue;
+                }
+            }
+            *unique_end++ = *it;
+        }
+        names.erase(unique_end, names.end());
+
+        for (seed_ = 0; seed_ < MAX_SEED; ++seed_) {
+            if (TryBuild(names)) {
+                name_count_ = name_count;
+                return;
+            }
+        }
+        throw std::runtime_error("Can't build perfect hash for names");
+    }
+
+    template<class GetName>
+    std::optional<uint32_t> NameIndex::Find(std::string_view name, GetName get_name) const {
+        if (slots_.empty()) {
+            return std::nullopt;
+        }
+        const uint64_t key = GetKey(name);
+        const Slot &slot = slots_[GetSlot(key, displacements_[GetBucket(key)])];
+        if (slot.id == EMPTY_SLOT || slot.key != key || get_name(slot.id) != name) {
+            return std::nullopt;
+        }
+        return slot.id;
+    }
+
+}
@@ -0,0 +1,197 @@
+#include "raptor_router.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace transport_catalogue {
+
+    template<class StopIter>
+    void RaptorRouter::AddPattern(size_t bus_id, StopIter begin, StopIter end,
+                                  std::vector<int>::const_iterator dist_begin) {
+        Pattern pattern{bus_id, pattern_stops_.size(), pattern_stops_.size()};
+
+        int64_t distance = 0;
+        for (auto stop_it = begin; stop_it != end; ++stop_it, ++dist_begin) {
+            pattern_stops_.push_back(*stop_it);
+            pattern_distances_.push_back(distance);
+            distance += *dist_begin;
+        }
+
+        pattern.end = pattern_stops_.size();
+        patterns_.push_back(pattern);
+    }
+
+    RaptorRouter::RaptorRouter(const TransportCatalogue &db, int wait_time, double bus_velocity)
+            : stop_count_(db.GetLastStopId()), wait_time_(wait_time), bus_velocity_(bus_velocity) {
+
+        for (const auto &bus: db.GetAllBuses()) {
+            const auto dist_vec = db.GetBusRealDistances(bus);
+            const auto stop_ids = db.GetBusStopIds(bus->id);
+
+            if (bus->is_circled) {
+                AddPattern(bus->id, stop_ids.begin(), stop_ids.end(), dist_vec.begin());
+            } else {
+                const auto second_end_stop = std::next(stop_ids.begin(), stop_ids.size() / 2);
+                AddPattern(bus->id, stop_ids.begin(), std::next(second_end_stop), dist_vec.begin());
+                AddPattern(bus->id, second_end_stop, stop_ids.end(),
+                           std::next(dist_vec.begin(), stop_ids.size() / 2));
+            }
+        }
+
+        stop_pattern_offsets_.assign(stop_count_ + 1, 0);
+        for (const auto stop_id: pattern_stops_) {
+            ++stop_pattern_offsets_[stop_id + 1];
+        }
+        for (size_t stop_id = 0; stop_id < stop_count_; ++stop_id) {
+            stop_pattern_offsets_[stop_id + 1] += stop_pattern_offsets_[stop_id];
+        }
+
+        stop_patterns_.resize(pattern_stops_.size());
+        std::vector<size_t> positions(stop_pattern_offsets_.begin(), std::prev(stop_pattern_offsets_.end()));
+        for (uint32_t pattern = 0; pattern < patterns_.size(); ++pattern) {
+            for (size_t i = patterns_[pattern].begin; i < patterns_[pattern].end; ++i) {
+                stop_patterns_[positions[pattern_stops_[i]]++] = {pattern,
+                                                                  static_cast<uint32_t>(i - patterns_[pattern].begin)};
+            }
+        }
+    }
+
+    size_t RaptorRouter::RunRounds(size_t stop_from_id, std::optional<size_t> stop_to_id, double max_time) const {
+        auto &state = GetSearchState();
+        state.labels.assign(stop_count_, UNREACHABLE_TIME);
+        state.parents.assign(stop_count_, Parent{});
+        state.best_labels.assign(stop_count_, UNREACHABLE_TIME);
+        state.is_marked.assign(stop_count_, false);
+        state.marked_stops.clear();
+        state.pattern_start_positions.assign(patterns_.size(), std::numeric_limits<uint32_t>::max());
+        state.queued_patterns.clear();
+
+        state.labels[stop_from_id] = 0;
+        state.best_labels[stop_from_id] = 0;
+        state.marked_stops.push_back(stop_from_id);
+
+        size_t round = 0;
+        while (!state.marked_stops.empty()) {
+            ++round;
+            state.labels.resize((round + 1) * stop_count_);
+            state.parents.resize((round + 1) * stop_count_, Parent{});
+            std::copy_n(state.labels.begin() + (round - 1) * stop_count_, stop_count_,
+                        state.labels.begin() + round * stop_count_);
+
+            const double *prev_labels = &state.labels[(round - 1) * stop_count_];
+            double *labels = &state.labels[round * stop_count_];
+            Parent *parents = &state.parents[round * stop_count_];
+
+            for (const auto stop_id: state.marked_stops) {
+                state.is_marked[stop_id] = false;
+                for (size_t i = stop_pattern_offsets_[stop_id]; i < stop_pattern_offsets_[stop_id + 1]; ++i) {
+                    const auto [pattern, position] = stop_patterns_[i];
+                    auto &start_position = state.pattern_start_positions[pattern];
+                    if (start_position == std::numeric_limits<uint32_t>::max()) {
+                        state.queued_patterns.push_back(pattern);
+                    }
+                    start_position = std::min(start_position, position);
+                }
+            }
+            state.marked_stops.clear();
+
+            for (const auto pattern_id: state.queued_patterns) {
+                const auto &pattern = patterns_[pattern_id];
+                const uint32_t start_position = state.pattern_start_positions[pattern_id];
+                state.pattern_start_positions[pattern_id] = std::numeric_limits<uint32_t>::max();
+
+                bool is_boarded = false;
+                double board_label = 0;
+                uint32_t board_position = 0;
+
+                for (uint32_t position = start_position; pattern.begin + position < pattern.end; ++position) {
+                    const size_t stop_id = pattern_stops_[pattern.begin + position];
+
+                    double arrival = UNREACHABLE_TIME;
+                    if (is_boarded) {
+                        arrival = board_label + 1.0 * (pattern_distances_[pattern.begin + position] -
+                                                       pattern_distances_[pattern.begin + board_position]) /
+                                                bus_velocity_;
+                        if (arrival < state.best_labels[stop_id] && arrival <= max_time &&
+                            (!stop_to_id || arrival < state.best_labels[*stop_to_id])) {
+                            labels[stop_id] = arrival;
+                            state.best_labels[stop_id] = arrival;
+                            parents[stop_id] = {pattern_id, board_position, position};
+                            if (!state.is_marked[stop_id]) {
+                                state.is_marked[stop_id] = true;
+                                state.marked_stops.push_back(stop_id);
+                            }
+                        }
+                    }
+
+                    if (prev_labels[stop_id] != UNREACHABLE_TIME) {
+                        const double board_candidate = prev_labels[stop_id] + wait_time_;
+                        if (!is_boarded || board_candidate < arrival) {
+                            is_boarded = true;
+                            board_label = board_candidate;
+                            board_position = position;
+                        }
+                    }
+                }
+            }
+            state.queued_patterns.clear();
+        }
+
+        return round;
+    }
+
+    std::optional<std::vector<RaptorLeg>> RaptorRouter::BuildRoute(size_t stop_from_id, size_t stop_to_id) const {
+        if (stop_from_id >= stop_count_ || stop_to_id >= stop_count_) {
+            return std::nullopt;
+        }
+
+        size_t round = RunRounds(stop_from_id, stop_to_id, UNREACHABLE_TIME);
+        const auto &state = GetSearchState();
+        if (state.best_labels[stop_to_id] == UNREACHABLE_TIME) {
+            return std::nullopt;
+        }
+
+        std::vector<RaptorLeg> legs;
+        size_t stop_id = stop_to_id;
+        while (stop_id != stop_from_id) {
+            while (round > 0 && state.parents[round * stop_count_ + stop_id].pattern == NO_PATTERN) {
+                --round;
+            }
+            if (round == 0) {
+                return std::nullopt;
+            }
+
+            const auto &parent = state.parents[round * stop_count_ + stop_id];
+            const auto &pattern = patterns_[parent.pattern];
+            const size_t board_stop_id = pattern_stops_[pattern.begin + parent.board_position];
+            const auto distance = pattern_distances_[pattern.begin + parent.alight_position] -
+                                  pattern_distances_[pattern.begin + parent.board_position];
+
+            legs.push_back({pattern.bus_id, board_stop_id,
+                            static_cast<int>(parent.alight_position - parent.board_position),
+                            1.0 * distance / bus_velocity_});
+            stop_id = board_stop_id;
+            --round;
+        }
+        std::reverse(legs.begin(), legs.end());
+
+        return legs;
+    }
+
+    std::vector<std::pair<size_t, double>> RaptorRouter::FindReachableStops(size_t stop_from_id, double max_time) const {
+        std::vector<std::pair<size_t, double>> reachable_stops;
+        if (stop_from_id >= stop_count_) {
+            return reachable_stops;
+        }
+
+        RunRounds(stop_from_id, std::nullopt, max_time);
+        const auto &state = GetSearchState();
+        for (size_t stop_id = 0; stop_id < stop_count_; ++stop_id) {
+            if (state.best_labels[stop_id] <= max_time) {
+                reachable_stops.emplace_back(stop_id, state.best_labels[stop_id]);
+            }
+        }
+        return reachable_stops;
+    }
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "transport_catalogue.h"
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace transport_catalogue {
+
+    // Участок поездки: посадка на автобус bus_id на остановке board_stop_id и проезд span остановок
+    struct RaptorLeg {
+        size_t bus_id = 0;
+        size_t board_stop_id = 0;
+        int span = 0;
+        double time = 0;
+    };
+
+    // Поиск маршрута по раундам (RAPTOR) прямо по спискам остановок автобусов, без графа.
+    // Раунд k — лучшие времена с не более чем k посадками; каждый раунд просматривает
+    // только маршруты, проходящие через остановки, улучшенные в предыдущем раунде.
+    class RaptorRouter {
+    public:
+        RaptorRouter(const TransportCatalogue &db, int wait_time, double bus_velocity);
+
+        std::optional<std::vector<RaptorLeg>> BuildRoute(size_t stop_from_id, size_t stop_to_id) const;
+
+        // Остановки, до которых можно добраться не дольше чем за max_time, с наименьшим временем
+        std::vector<std::pair<size_t, double>> FindReachableStops(size_t stop_from_id, double max_time) const;
+
+    private:
+        static constexpr double UNREACHABLE_TIME = std::numeric_limits<double>::infinity();
+        static constexpr uint32_t NO_PATTERN = std::numeric_limits<uint32_t>::max();
+
+        // Паттерн — направление автобуса: весь маршрут для кольцевого, половина для линейного
+        struct Pattern {
+            size_t bus_id = 0;
+            size_t begin = 0;
+            size_t end = 0;
+        };
+
+        struct StopPatternPosition {
+            uint32_t pattern = 0;
+            uint32_t position = 0;
+        };
+
+        struct Parent {
+            uint32_t pattern = NO_PATTERN;
+            uint32_t board_position = 0;
+            uint32_t alight_position = 0;
+        };
+
+        // Плоские массивы меток по остановкам для всех раундов; переиспользуются между запросами
+        struct SearchState {
+            std::vector<double> labels;
+            std::vector<Parent> parents;
+            std::vector<double> best_labels;
+            std::vector<bool> is_marked;
+            std::vector<size_t> marked_stops;
+            std::vector<uint32_t> pattern_start_positions;
+            std::vector<uint32_t> queued_patterns;
+        };
+
+        template<class StopIter>
+        void AddPattern(size_t bus_id, StopIter begin, StopIter end, std::vector<int>::const_iterator dist_begin);
+
+        // Раунды поиска от stop_from_id; метки дальше max_time и не лучше текущей метки цели отсекаются.
+        // Возвращает номер последнего раунда
+        size_t RunRounds(size_t stop_from_id, std::optional<size_t> stop_to_id, double max_time) const;
+
+        static SearchState &GetSearchState() {
+            static thread_local SearchState state;
+            return state;
+        }
+
+        size_t stop_count_ = 0;
+        int wait_time_ = 1;
+        double bus_velocity_ = 1;
+
+        std::vector<Pattern> patterns_;
+        std::vector<uint32_t> pattern_stops_;
+        std::vector<int64_t> pattern_distances_;
+
+        std::vector<size_t> stop_pattern_offsets_;
+        std::vector<StopPatternPosition> stop_patterns_;
+    };
+
+}
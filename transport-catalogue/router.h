@@ -1,14 +1,21 @@
 #pragma once
 
+#include "floyd_warshall_kernels.h"
 #include "graph.h"
+#include "heap.h"
+#include "search_state.h"
 #include "transport_router.pb.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -18,108 +25,252 @@
 
 namespace graph {
 
+    // Общий интерфейс движков поиска маршрута: TransportRouter выбирает реализацию по настройкам
     template<typename Weight>
-    class Router {
+    class RouteBuilder {
+    public:
+        struct RouteInfo {
+            Weight weight;
+            std::vector<EdgeId> edges;
+        };
+
+        virtual ~RouteBuilder() = default;
+
+        virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+        // Только вес кратчайшего пути, без списка рёбер; движки с готовой таблицей отвечают без поиска
+        virtual std::optional<Weight> GetRouteWeight(VertexId from, VertexId to) const {
+            const auto route = BuildRoute(from, to);
+            if (!route) {
+                return std::nullopt;
+            }
+            return route->weight;
+        }
+    };
+
+    // Вызывает task(i) для каждого i из [0, task_count) на thread_count потоках (0 — в текущем потоке)
+    template<typename Task>
+    void RunInParallel(size_t task_count, size_t thread_count, Task task) {
+        std::atomic<size_t> next_task{0};
+        auto worker = [&task, &next_task, task_count]() {
+            for (size_t i = next_task++; i < task_count; i = next_task++) {
+                task(i);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < std::min(thread_count, task_count); ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread: threads) {
+            thread.join();
+        }
+    }
+
+    template<typename Weight>
+    class Router final : public RouteBuilder<Weight> {
     private:
         using Graph = DirectedWeightedGraph<Weight>;
 
     public:
+        using RouteInfo = typename RouteBuilder<Weight>::RouteInfo;
 
-
-        explicit Router(const Graph &graph);
+        // Таблица строится блочным алгоритмом Флойда–Уоршелла; thread_count > 0 — на thread_count потоках.
+        // Потоки делят между собой независимые блоки одного шага, поэтому таблица побитово та же,
+        // что при последовательном построении
+        explicit Router(const Graph &graph, size_t thread_count = 0);
 
         explicit Router(const Graph &graph, const transport_catalogue_protobuf::RouterRoutesInternalData &proto_router_routes_internal_data);
 
-        struct RouteInfo {
-            Weight weight;
-            std::vector<EdgeId> edges;
-        };
+        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+        std::optional<Weight> GetRouteWeight(VertexId from, VertexId to) const override;
+
+        // Граф по ссылке заменён новым с теми же вершинами. edge_mapping[old_edge_id] — номер того же ребра
+        // с тем же весом в новом графе или NO_EDGE, если ребро удалено или изменилось.
+        // В каждой строке сбрасываются только метки вершин, путь к которым шёл через пропавшее ребро,
+        // и от них и от новых рёбер запускается Дейкстра; остальные метки лишь перенумеровываются.
+        // Возвращает число пересчитанных меток
+        size_t Update(const std::vector<EdgeId> &edge_mapping);
 
-        std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+        // То же для графа, где вершины добавлены или удалены. vertex_mapping[old_vertex] — номер той же
+        // вершины в новом графе или NO_VERTEX; сопоставленное ребро должно соединять образы своих концов.
+        // Метки переносятся в таблицу нового размера, строки и столбцы новых вершин начинаются пустыми
+        size_t Update(const std::vector<VertexId> &vertex_mapping, const std::vector<EdgeId> &edge_mapping);
 
         void Deserialize(const transport_catalogue_protobuf::RouterRoutesInternalData &proto_router_routes_internal_data);
 
         transport_catalogue_protobuf::RouterRoutesInternalData Serialize() const;
 
+        // Та же таблица двумя упакованными массивами; Deserialize читает таблицу в любом из двух форматов.
+        // Базу целиком это не делает совместимой: TransportRouter отвергает базы прежних форматов
+        transport_catalogue_protobuf::RouterRoutesInternalData SerializePacked() const;
+
 
     private:
 
-        struct RouteInternalData {
-            Weight weight;
-            std::optional<EdgeId> prev_edge;
-        };
+        // Таблица маршрутов хранится плоско, одним блоком на V×V ячеек: вес пути и последнее ребро.
+        // Недостижимость кодируется весом UNREACHABLE_WEIGHT, отсутствие ребра — NO_PREV_EDGE.
+        using PrevEdge = uint32_t;
+
+        static constexpr Weight ZERO_WEIGHT{};
+        static constexpr Weight UNREACHABLE_WEIGHT = std::numeric_limits<Weight>::has_infinity
+                                                     ? std::numeric_limits<Weight>::infinity()
+                                                     : std::numeric_limits<Weight>::max();
+        static constexpr PrevEdge NO_PREV_EDGE = std::numeric_limits<PrevEdge>::max();
+        static constexpr size_t FLOYD_WARSHALL_BLOCK_SIZE = 64;
+
+        size_t GetIndex(VertexId vertex_from, VertexId vertex_to) const {
+            return vertex_from * vertex_count_ + vertex_to;
+        }
+
+        void ResizeRoutesInternalData(size_t vertex_count) {
+            vertex_count_ = vertex_count;
+            weights_.assign(vertex_count * vertex_count, UNREACHABLE_WEIGHT);
+            prev_edges_.assign(vertex_count * vertex_count, NO_PREV_EDGE);
+        }
 
-        using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+        void CheckEdges(const Graph &graph) const {
+            if (!graph.IsFrozen()) {
+                throw std::logic_error("Graph should be frozen before routing");
+            }
+            if (graph.GetEdgeCount() >= NO_PREV_EDGE) {
+                throw std::length_error("Too many edges for the route table");
+            }
+            for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+                if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                    throw std::domain_error("Edges' weights should be non-negative");
+                }
+            }
+        }
 
         void InitializeRoutesInternalData(const Graph &graph) {
-            const size_t vertex_count = graph.GetVertexCount();
-            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-                routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
-                for (const EdgeId edge_id: graph.GetIncidentEdges(vertex)) {
-                    const auto &edge = graph.GetEdge(edge_id);
-                    if (edge.weight < ZERO_WEIGHT) {
-                        throw std::domain_error("Edges' weights should be non-negative");
-                    }
-                    auto &route_internal_data = routes_internal_data_[vertex][edge.to];
-                    if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                        route_internal_data = RouteInternalData{edge.weight, edge_id};
+            ResizeRoutesInternalData(graph.GetVertexCount());
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                weights_[GetIndex(vertex, vertex)] = ZERO_WEIGHT;
+                for (size_t arc = graph.GetArcsBegin(vertex); arc < graph.GetArcsEnd(vertex); ++arc) {
+                    const size_t index = GetIndex(vertex, graph.GetArcTarget(arc));
+                    if (weights_[index] > graph.GetArcWeight(arc)) {
+                        weights_[index] = graph.GetArcWeight(arc);
+                        prev_edges_[index] = static_cast<PrevEdge>(graph.GetArcEdge(arc));
                     }
                 }
             }
         }
 
-        void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData &route_from,
-                        const RouteInternalData &route_to) {
-            auto &route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-            const Weight candidate_weight = route_from.weight + route_to.weight;
-            if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-                route_relaxing = {candidate_weight,
-                                  route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+        // Блочный алгоритм Флойда–Уоршелла: таблица делится на квадраты FLOYD_WARSHALL_BLOCK_SIZE²,
+        // на каждом шаге сначала обрабатывается диагональный блок, затем его строка и столбец,
+        // затем остальные блоки — так рабочие данные шага помещаются в кэш
+        void RelaxBlock(size_t block_from, size_t block_to, size_t block_through) {
+            const size_t from_end = std::min(block_from + FLOYD_WARSHALL_BLOCK_SIZE, vertex_count_);
+            const size_t to_end = std::min(block_to + FLOYD_WARSHALL_BLOCK_SIZE, vertex_count_);
+            const size_t through_end = std::min(block_through + FLOYD_WARSHALL_BLOCK_SIZE, vertex_count_);
+
+            for (VertexId vertex_through = block_through; vertex_through < through_end; ++vertex_through) {
+                const size_t through_index = GetIndex(vertex_through, block_to);
+                for (VertexId vertex_from = block_from; vertex_from < from_end; ++vertex_from) {
+                    const size_t index_from = GetIndex(vertex_from, vertex_through);
+                    if (weights_[index_from] == UNREACHABLE_WEIGHT) {
+                        continue;
+                    }
+                    const size_t row_index = GetIndex(vertex_from, block_to);
+                    detail::RelaxRow(weights_[index_from], prev_edges_[index_from],
+                                     &weights_[through_index], &prev_edges_[through_index],
+                                     &weights_[row_index], &prev_edges_[row_index],
+                                     to_end - block_to, UNREACHABLE_WEIGHT, NO_PREV_EDGE);
+                }
             }
         }
 
-        void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-            for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-                if (const auto &route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                    for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                        if (const auto &route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                            RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+        // Блоки строки и столбца диагонального блока читают только его и себя, остальные блоки —
+        // только блоки этой строки и столбца, поэтому внутри каждой из двух фаз шага блоки
+        // независимы и обрабатываются параллельно в том же порядке вычислений, что и последовательно
+        void RelaxRoutesInternalData(size_t thread_count) {
+            const size_t block_count = (vertex_count_ + FLOYD_WARSHALL_BLOCK_SIZE - 1) / FLOYD_WARSHALL_BLOCK_SIZE;
+            for (size_t block_through = 0; block_through < vertex_count_; block_through += FLOYD_WARSHALL_BLOCK_SIZE) {
+                RelaxBlock(block_through, block_through, block_through);
+
+                RunInParallel(block_count, thread_count, [this, block_through](size_t block_index) {
+                    const size_t block = block_index * FLOYD_WARSHALL_BLOCK_SIZE;
+                    if (block != block_through) {
+                        RelaxBlock(block_through, block, block_through);
+                        RelaxBlock(block, block_through, block_through);
+                    }
+                });
+
+                RunInParallel(block_count, thread_count, [this, block_through](size_t block_index) {
+                    const size_t block_from = block_index * FLOYD_WARSHALL_BLOCK_SIZE;
+                    if (block_from == block_through) {
+                        return;
+                    }
+                    for (size_t block_to = 0; block_to < vertex_count_; block_to += FLOYD_WARSHALL_BLOCK_SIZE) {
+                        if (block_to != block_through) {
+                            RelaxBlock(block_from, block_to, block_through);
                         }
                     }
+                });
+            }
+        }
+
+        void DeserializePacked(const transport_catalogue_protobuf::RouterRoutesInternalData &proto_router_routes_internal_data);
+
+        // Таблица под число вершин графа: метки между сохранившимися вершинами переносятся на новые места
+        // с прежними номерами последних рёбер, остальные ячейки недостижимы, кроме диагонали
+        void RemapVertices(const std::vector<VertexId> &vertex_mapping);
+
+        // Загруженная таблица должна подходить к своему графу, иначе BuildRoute читал бы за границами
+        void CheckTableVertexCount(size_t vertex_count) const {
+            if (vertex_count != graph_.GetVertexCount()) {
+                throw std::runtime_error("Route table doesn't match the graph, rebuild the base");
+            }
+        }
+
+        void CheckPrevEdges() const {
+            for (const PrevEdge prev_edge: prev_edges_) {
+                if (prev_edge != NO_PREV_EDGE && prev_edge >= graph_.GetEdgeCount()) {
+                    throw std::runtime_error("Route table refers to a missing edge, rebuild the base");
                 }
             }
         }
 
-        static constexpr Weight ZERO_WEIGHT{};
         const Graph &graph_;
-        RoutesInternalData routes_internal_data_;
+        size_t vertex_count_ = 0;
+        std::vector<Weight> weights_;
+        std::vector<PrevEdge> prev_edges_;
     };
 
     template<typename Weight>
     void Router<Weight>::Deserialize(
             const transport_catalogue_protobuf::RouterRoutesInternalData &proto_router_routes_internal_data) {
-        routes_internal_data_.clear();
-        routes_internal_data_.resize(proto_router_routes_internal_data.routes_internal_data_size());
-        auto routes_internal_data_it = routes_internal_data_.begin();
+        if (proto_router_routes_internal_data.routes_internal_data().empty()) {
+            DeserializePacked(proto_router_routes_internal_data);
+            return;
+        }
+        CheckTableVertexCount(proto_router_routes_internal_data.routes_internal_data_size());
+        ResizeRoutesInternalData(proto_router_routes_internal_data.routes_internal_data_size());
 
+        VertexId vertex_from = 0;
         for (const auto &proto_routes_internal_data: proto_router_routes_internal_data.routes_internal_data()) {
-            routes_internal_data_it->resize(proto_routes_internal_data.optional_route_internal_data_vector_size());
-            auto optional_route_internal_data_it = routes_internal_data_it->begin();
-
+            if (static_cast<size_t>(proto_routes_internal_data.optional_route_internal_data_vector_size())
+                != vertex_count_) {
+                throw std::runtime_error("Route table row size doesn't match its vertex count");
+            }
+            VertexId vertex_to = 0;
             for (const auto &proto_optional_route_internal_data: proto_routes_internal_data.optional_route_internal_data_vector()) {
                 if (proto_optional_route_internal_data.is_present()) {
                     const auto &proto_route_internal_data = proto_optional_route_internal_data.route_internal_data();
-                    auto weight = proto_route_internal_data.weight();
-
-                    *optional_route_internal_data_it = proto_route_internal_data.has_prev_edge() ? std::move(
-                            RouteInternalData{weight, proto_route_internal_data.prev_edge()}) : std::move(
-                            RouteInternalData{weight, std::nullopt});
-
+                    const size_t index = GetIndex(vertex_from, vertex_to);
+                    weights_[index] = static_cast<Weight>(proto_route_internal_data.weight());
+                    if (proto_route_internal_data.has_prev_edge()) {
+                        prev_edges_[index] = static_cast<PrevEdge>(proto_route_internal_data.prev_edge());
+                    }
                 }
-                ++optional_route_internal_data_it;
+                ++vertex_to;
             }
-            ++routes_internal_data_it;
+            ++vertex_from;
         }
+        CheckPrevEdges();
     }
 
 
@@ -127,17 +278,18 @@ namespace graph {
     transport_catalogue_protobuf::RouterRoutesInternalData Router<Weight>::Serialize() const {
         transport_catalogue_protobuf::RouterRoutesInternalData router_routes_internal_data;
 
-        for (const auto &route_internal_data: routes_internal_data_) {
+        for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
             transport_catalogue_protobuf::RoutesInternalData proto_routes_internal_data;
 
-            for (const auto &internal_data: route_internal_data) {
+            for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
                 transport_catalogue_protobuf::OptionalRouteInternalData proto_optional_route_internal_data;
+                const size_t index = GetIndex(vertex_from, vertex_to);
 
-                if (internal_data) {
+                if (weights_[index] != UNREACHABLE_WEIGHT) {
                     transport_catalogue_protobuf::RouteInternalData proto_route_internal_data;
-                    proto_route_internal_data.set_weight(internal_data->weight);
-                    if (internal_data->prev_edge) {
-                        proto_route_internal_data.set_prev_edge(internal_data->prev_edge.value());
+                    proto_route_internal_data.set_weight(weights_[index]);
+                    if (prev_edges_[index] != NO_PREV_EDGE) {
+                        proto_route_internal_data.set_prev_edge(prev_edges_[index]);
                         proto_route_internal_data.set_has_prev_edge(true);
                     } else {
                         proto_route_internal_data.set_has_prev_edge(false);
@@ -156,18 +308,58 @@ namespace graph {
         return router_routes_internal_data;
     }
 
-
     template<typename Weight>
-    Router<Weight>::Router(const Graph &graph)
-            : graph_(graph), routes_internal_data_(graph.GetVertexCount(),
-                                                   std::vector<std::optional<RouteInternalData>>(
-                                                           graph.GetVertexCount())) {
-        InitializeRoutesInternalData(graph);
+    transport_catalogue_protobuf::RouterRoutesInternalData Router<Weight>::SerializePacked() const {
+        transport_catalogue_protobuf::RouterRoutesInternalData router_routes_internal_data;
 
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-            RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+        router_routes_internal_data.set_vertex_count(vertex_count_);
+        if constexpr (std::is_integral_v<Weight>) {
+            router_routes_internal_data.mutable_integer_weights()->Add(weights_.begin(), weights_.end());
+        } else {
+            router_routes_internal_data.mutable_weights()->Add(weights_.begin(), weights_.end());
         }
+        auto &proto_prev_edges = *router_routes_internal_data.mutable_prev_edges();
+        proto_prev_edges.Reserve(static_cast<int>(prev_edges_.size()));
+        for (const PrevEdge prev_edge: prev_edges_) {
+            // NO_PREV_EDGE + 1 == 0: самое частое значение занимает один байт
+            proto_prev_edges.AddAlreadyReserved(static_cast<PrevEdge>(prev_edge + 1));
+        }
+        return router_routes_internal_data;
+    }
+
+    template<typename Weight>
+    void Router<Weight>::DeserializePacked(
+            const transport_catalogue_protobuf::RouterRoutesInternalData &proto_router_routes_internal_data) {
+        const size_t vertex_count = proto_router_routes_internal_data.vertex_count();
+        const auto &proto_weights = [&]() -> const auto & {
+            if constexpr (std::is_integral_v<Weight>) {
+                return proto_router_routes_internal_data.integer_weights();
+            } else {
+                return proto_router_routes_internal_data.weights();
+            }
+        }();
+        const auto &proto_prev_edges = proto_router_routes_internal_data.prev_edges();
+        if (static_cast<size_t>(proto_weights.size()) != vertex_count * vertex_count ||
+            static_cast<size_t>(proto_prev_edges.size()) != vertex_count * vertex_count) {
+            throw std::runtime_error("Route table size doesn't match its vertex count");
+        }
+        CheckTableVertexCount(vertex_count);
+
+        vertex_count_ = vertex_count;
+        weights_.assign(proto_weights.begin(), proto_weights.end());
+        prev_edges_.resize(proto_prev_edges.size());
+        std::transform(proto_prev_edges.begin(), proto_prev_edges.end(), prev_edges_.begin(),
+                       [](uint32_t prev_edge) { return static_cast<PrevEdge>(prev_edge - 1); });
+        CheckPrevEdges();
+    }
+
+
+    template<typename Weight>
+    Router<Weight>::Router(const Graph &graph, size_t thread_count)
+            : graph_(graph) {
+        CheckEdges(graph);
+        InitializeRoutesInternalData(graph);
+        RelaxRoutesInternalData(thread_count);
     }
 
     template<typename Weight>
@@ -179,20 +371,214 @@ namespace graph {
     template<typename Weight>
     std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                                  VertexId to) const {
-        const auto &route_internal_data = routes_internal_data_.at(from).at(to);
-        if (!route_internal_data) {
+        if (from >= vertex_count_ || to >= vertex_count_) {
+            return std::nullopt;
+        }
+        const size_t index = GetIndex(from, to);
+        if (weights_[index] == UNREACHABLE_WEIGHT) {
             return std::nullopt;
         }
-        const Weight weight = route_internal_data->weight;
+        const Weight weight = weights_[index];
+        const PrevEdge *row_prev_edges = &prev_edges_[GetIndex(from, 0)];
+
         std::vector<EdgeId> edges;
-        for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-             edge_id;
-             edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge) {
-            edges.push_back(*edge_id);
+        for (PrevEdge edge_id = row_prev_edges[to];
+             edge_id != NO_PREV_EDGE;
+             edge_id = row_prev_edges[graph_.GetEdge(edge_id).from]) {
+            edges.push_back(edge_id);
         }
         std::reverse(edges.begin(), edges.end());
 
         return RouteInfo{weight, std::move(edges)};
     }
 
-}  // namespace graph
\ No newline at end of file
+    template<typename Weight>
+    size_t Router<Weight>::Update(const std::vector<EdgeId> &edge_mapping) {
+        CheckEdges(graph_);
+        if (graph_.GetVertexCount() != vertex_count_) {
+            throw std::logic_error("Route table can be updated only for the same vertices");
+        }
+
+        // Рёбра нового графа, которым не сопоставлено ни одно прежнее, — добавленные или изменённые
+        std::vector<bool> is_mapped(graph_.GetEdgeCount(), false);
+        for (const EdgeId edge_id: edge_mapping) {
+            if (edge_id != NO_EDGE) {
+                is_mapped[edge_id] = true;
+            }
+        }
+        std::vector<EdgeId> new_edges;
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            if (!is_mapped[edge_id]) {
+                new_edges.push_back(edge_id);
+            }
+        }
+
+        // Входящие рёбра: по ним ищутся новые пути к вершинам, потерявшим прежний
+        std::vector<size_t> in_offsets(vertex_count_ + 1, 0);
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            ++in_offsets[graph_.GetEdge(edge_id).to + 1];
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            in_offsets[vertex + 1] += in_offsets[vertex];
+        }
+        std::vector<EdgeId> in_edges(graph_.GetEdgeCount());
+        std::vector<size_t> positions(in_offsets.begin(), std::prev(in_offsets.end()));
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            in_edges[positions[graph_.GetEdge(edge_id).to]++] = edge_id;
+        }
+
+        enum class LabelState : uint8_t {
+            UNKNOWN,
+            IN_PROGRESS,
+            VALID,
+            INVALID,
+        };
+        std::vector<LabelState> states(vertex_count_);
+        std::vector<VertexId> chain;
+        DijkstraHeap<Weight> heap;
+        size_t repaired_labels = 0;
+
+        for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+            Weight *row_weights = &weights_[GetIndex(vertex_from, 0)];
+            PrevEdge *row_prev_edges = &prev_edges_[GetIndex(vertex_from, 0)];
+
+            // Метка недействительна, если путь к вершине в дереве строки проходит через пропавшее ребро
+            std::fill(states.begin(), states.end(), LabelState::UNKNOWN);
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                VertexId current = vertex;
+                chain.clear();
+                while (states[current] == LabelState::UNKNOWN) {
+                    const PrevEdge prev_edge = row_prev_edges[current];
+                    if (prev_edge == NO_PREV_EDGE) {
+                        states[current] = LabelState::VALID;
+                    } else if (edge_mapping[prev_edge] == NO_EDGE) {
+                        states[current] = LabelState::INVALID;
+                    } else {
+                        states[current] = LabelState::IN_PROGRESS;
+                        chain.push_back(current);
+                        current = graph_.GetEdge(edge_mapping[prev_edge]).from;
+                    }
+                }
+                const LabelState state = states[current] == LabelState::IN_PROGRESS ? LabelState::INVALID
+                                                                                     : states[current];
+                for (const VertexId chain_vertex: chain) {
+                    states[chain_vertex] = state;
+                }
+            }
+
+            heap.Clear();
+            auto relax = [&](EdgeId edge_id) {
+                const auto &edge = graph_.GetEdge(edge_id);
+                if (row_weights[edge.from] == UNREACHABLE_WEIGHT) {
+                    return;
+                }
+                const Weight candidate_weight = row_weights[edge.from] + edge.weight;
+                if (candidate_weight < row_weights[edge.to]) {
+                    row_weights[edge.to] = candidate_weight;
+                    row_prev_edges[edge.to] = static_cast<PrevEdge>(edge_id);
+                    heap.Push(candidate_weight, edge.to);
+                }
+            };
+
+            bool has_invalid = false;
+            for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                if (states[vertex] == LabelState::INVALID) {
+                    row_weights[vertex] = UNREACHABLE_WEIGHT;
+                    row_prev_edges[vertex] = NO_PREV_EDGE;
+                    has_invalid = true;
+                } else if (row_prev_edges[vertex] != NO_PREV_EDGE) {
+                    row_prev_edges[vertex] = static_cast<PrevEdge>(edge_mapping[row_prev_edges[vertex]]);
+                }
+            }
+            if (has_invalid) {
+                for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+                    if (states[vertex] != LabelState::INVALID) {
+                        continue;
+                    }
+                    for (size_t i = in_offsets[vertex]; i < in_offsets[vertex + 1]; ++i) {
+                        relax(in_edges[i]);
+                    }
+                }
+            }
+            for (const EdgeId edge_id: new_edges) {
+                relax(edge_id);
+            }
+
+            // Дейкстра только от вершин, чьи метки изменились
+            while (!heap.Empty()) {
+                const auto [weight, vertex] = heap.Pop();
+                if (row_weights[vertex] < weight) {
+                    continue;
+                }
+                ++repaired_labels;
+                for (size_t arc = graph_.GetArcsBegin(vertex); arc < graph_.GetArcsEnd(vertex); ++arc) {
+                    relax(graph_.GetArcEdge(arc));
+                }
+            }
+        }
+        return repaired_labels;
+    }
+
+    template<typename Weight>
+    void Router<Weight>::RemapVertices(const std::vector<VertexId> &vertex_mapping) {
+        const size_t vertex_count = graph_.GetVertexCount();
+        if (vertex_mapping.size() != vertex_count_) {
+            throw std::logic_error("Vertex mapping should cover every vertex of the route table");
+        }
+        std::vector<bool> is_mapped(vertex_count, false);
+        for (const VertexId vertex: vertex_mapping) {
+            if (vertex == NO_VERTEX) {
+                continue;
+            }
+            if (vertex >= vertex_count || is_mapped[vertex]) {
+                throw std::logic_error("Vertex mapping should be injective into the new graph");
+            }
+            is_mapped[vertex] = true;
+        }
+
+        std::vector<Weight> weights(vertex_count * vertex_count, UNREACHABLE_WEIGHT);
+        std::vector<PrevEdge> prev_edges(vertex_count * vertex_count, NO_PREV_EDGE);
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            weights[vertex * vertex_count + vertex] = ZERO_WEIGHT;
+        }
+        for (VertexId vertex_from = 0; vertex_from < vertex_count_; ++vertex_from) {
+            const VertexId new_from = vertex_mapping[vertex_from];
+            if (new_from == NO_VERTEX) {
+                continue;
+            }
+            for (VertexId vertex_to = 0; vertex_to < vertex_count_; ++vertex_to) {
+                const VertexId new_to = vertex_mapping[vertex_to];
+                if (new_to == NO_VERTEX) {
+                    continue;
+                }
+                const size_t index = new_from * vertex_count + new_to;
+                weights[index] = weights_[GetIndex(vertex_from, vertex_to)];
+                prev_edges[index] = prev_edges_[GetIndex(vertex_from, vertex_to)];
+            }
+        }
+
+        vertex_count_ = vertex_count;
+        weights_ = std::move(weights);
+        prev_edges_ = std::move(prev_edges);
+    }
+
+    template<typename Weight>
+    size_t Router<Weight>::Update(const std::vector<VertexId> &vertex_mapping,
+                                  const std::vector<EdgeId> &edge_mapping) {
+        RemapVertices(vertex_mapping);
+        return Update(edge_mapping);
+    }
+
+    template<typename Weight>
+    std::optional<Weight> Router<Weight>::GetRouteWeight(VertexId from, VertexId to) const {
+        if (from >= vertex_count_ || to >= vertex_count_) {
+            return std::nullopt;
+        }
+        const Weight weight = weights_[GetIndex(from, to)];
+        if (weight == UNREACHABLE_WEIGHT) {
+            return std::nullopt;
+        }
+        return weight;
+    }
+
+}  // namespace graph
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "graph.h"
+#include "heap.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace graph {
+
+    inline constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    inline constexpr VertexId NO_VERTEX = std::numeric_limits<VertexId>::max();
+
+    // Рабочие массивы поиска кратчайших путей. Держатся по одному набору на поток и
+    // переиспользуются между запросами; метка поколения избавляет от очистки массивов.
+    // Радиксная куча по умолчанию требует неубывающих ключей; поиску, где это не так, нужна Heap = BinaryHeap.
+    template<typename Weight, typename Heap = DijkstraHeap<Weight>>
+    struct SearchState {
+        std::vector<Weight> weights;
+        std::vector<EdgeId> prev_edges;
+        std::vector<uint32_t> marks;
+        uint32_t mark = 0;
+        Heap heap;
+
+        void Reset(size_t vertex_count) {
+            if (marks.size() < vertex_count) {
+                weights.resize(vertex_count);
+                prev_edges.resize(vertex_count);
+                marks.resize(vertex_count, 0);
+            }
+            if (++mark == 0) {
+                std::fill(marks.begin(), marks.end(), 0);
+                mark = 1;
+            }
+            heap.Clear();
+        }
+
+        bool IsReached(VertexId vertex) const {
+            return marks[vertex] == mark;
+        }
+
+        void Reach(VertexId vertex, Weight weight, EdgeId prev_edge) {
+            marks[vertex] = mark;
+            weights[vertex] = weight;
+            prev_edges[vertex] = prev_edge;
+            heap.Push(weight, vertex);
+        }
+    };
+
+}  // namespace graph
@@ -0,0 +1,113 @@
+#include "astar_router.h"
+#include "contraction_hierarchy.h"
+#include "dijkstra_router.h"
+#include "hub_labels.h"
+#include "test_city.h"
+#include "test_utils.h"
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+using namespace std::literals;
+
+namespace {
+
+    using tests::Check;
+    using tests::CheckThrows;
+    using tests::IsRouteValid;
+    using tests::IsSameWeight;
+
+    // Движок сравнивается с поиском Дейкстры для каждой пары вершин: совпадают достижимость и вес
+    // (вещественный — с точностью до округления) у BuildRoute и GetRouteWeight, а маршрут — настоящий
+    // путь своего веса
+    template<typename Weight>
+    void CheckEngine(const std::string &label, const graph::DirectedWeightedGraph<Weight> &graph,
+                     const graph::RouteBuilder<Weight> &engine) {
+        const graph::DijkstraRouter<Weight> dijkstra(graph);
+
+        size_t mismatch_count = 0;
+        for (graph::VertexId from = 0; from < graph.GetVertexCount(); ++from) {
+            for (graph::VertexId to = 0; to < graph.GetVertexCount(); ++to) {
+                const auto expected = dijkstra.BuildRoute(from, to);
+                const auto route = engine.BuildRoute(from, to);
+                const auto weight = engine.GetRouteWeight(from, to);
+
+                bool is_same = expected.has_value() == route.has_value() && route.has_value() == weight.has_value();
+                if (is_same && route) {
+                    is_same = IsSameWeight(expected->weight, route->weight)
+                              && IsSameWeight(expected->weight, *weight)
+                              && IsRouteValid(graph, from, to, *route);
+                }
+                if (!is_same) {
+                    ++mismatch_count;
+                }
+            }
+        }
+        Check(mismatch_count == 0, label + ": "s + std::to_string(mismatch_count) + " route mismatches"s);
+    }
+
+    template<typename Weight>
+    void TestEngines(const std::string &label, uint32_t seed, size_t stop_count, size_t bus_count) {
+        const auto city = tests::MakeCity<Weight>(seed, stop_count, bus_count);
+
+        const graph::ContractionHierarchy<Weight> contraction_hierarchy(city.graph);
+        CheckEngine(label + ", contraction hierarchy"s, city.graph, contraction_hierarchy);
+        CheckEngine(label + ", loaded contraction hierarchy"s, city.graph,
+                    graph::ContractionHierarchy<Weight>(city.graph, contraction_hierarchy.Serialize()));
+
+        const graph::HubLabels<Weight> hub_labels(city.graph, contraction_hierarchy.GetRanks());
+        CheckEngine(label + ", hub labels"s, city.graph, hub_labels);
+        CheckEngine(label + ", loaded hub labels"s, city.graph,
+                    graph::HubLabels<Weight>(city.graph, hub_labels.Serialize()));
+
+        CheckEngine(label + ", A*"s, city.graph,
+                    graph::AStarRouter<Weight>(city.graph, city.coordinates, city.weight_per_meter));
+    }
+
+    // Данные, сохранённые для одного графа, не загружаются для другого
+    template<typename Weight>
+    void TestMismatchedBases(const std::string &label) {
+        const auto city = tests::MakeCity<Weight>(1, 120, 50);
+        const auto other_city = tests::MakeCity<Weight>(2, 60, 20);
+
+        const graph::ContractionHierarchy<Weight> contraction_hierarchy(city.graph);
+        const auto proto_contraction_hierarchy = contraction_hierarchy.Serialize();
+        CheckThrows([&] { graph::ContractionHierarchy<Weight>(other_city.graph, proto_contraction_hierarchy); },
+                    label + ": contraction hierarchy of another graph"s);
+        auto broken_shortcut = proto_contraction_hierarchy;
+        const size_t edge_count = city.graph.GetEdgeCount() + broken_shortcut.shortcuts_size();
+        broken_shortcut.mutable_shortcuts(0)->set_first_edge(edge_count);
+        CheckThrows([&] { graph::ContractionHierarchy<Weight>(city.graph, broken_shortcut); },
+                    label + ": shortcut made of a missing edge"s);
+        broken_shortcut = proto_contraction_hierarchy;
+        broken_shortcut.mutable_shortcuts(0)->set_to(city.graph.GetVertexCount());
+        CheckThrows([&] { graph::ContractionHierarchy<Weight>(city.graph, broken_shortcut); },
+                    label + ": shortcut to a missing vertex"s);
+
+        const graph::HubLabels<Weight> hub_labels(city.graph, contraction_hierarchy.GetRanks());
+        const auto proto_hub_labels = hub_labels.Serialize();
+        CheckThrows([&] { graph::HubLabels<Weight>(other_city.graph, proto_hub_labels); },
+                    label + ": hub labels of another graph"s);
+        auto broken_labels = proto_hub_labels;
+        broken_labels.mutable_out_labels()->set_hubs(0, city.graph.GetVertexCount());
+        CheckThrows([&] { graph::HubLabels<Weight>(city.graph, broken_labels); }, label + ": missing hub"s);
+        broken_labels = proto_hub_labels;
+        broken_labels.mutable_in_labels()->mutable_hubs()->RemoveLast();
+        CheckThrows([&] { graph::HubLabels<Weight>(city.graph, broken_labels); },
+                    label + ": label offsets past the hubs"s);
+    }
+
+}
+
+int main() {
+    for (const uint32_t seed: {1, 2, 3}) {
+        const std::string label = "seed "s + std::to_string(seed);
+        TestEngines<double>(label + ", double weights"s, seed, 120, 50);
+        TestEngines<uint32_t>(label + ", integer weights"s, seed, 120, 50);
+    }
+    TestEngines<double>("sparse city"s, 4, 200, 15);
+    TestMismatchedBases<double>("mismatched bases, double weights"s);
+    TestMismatchedBases<uint32_t>("mismatched bases, integer weights"s);
+    return tests::Finish("engines_test"s);
+}
@@ -0,0 +1,79 @@
+#include "heap.h"
+#include "test_utils.h"
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+
+using namespace std::literals;
+
+namespace {
+
+    using tests::Check;
+
+    // Радиксная куча сравнивается с упорядоченным множеством на последовательности как в поиске
+    // Дейкстры: новые ключи не меньше последнего извлечённого. Извлекается минимальный ключ,
+    // и каждый элемент выходит ровно один раз
+    template<typename Weight>
+    void TestRadixHeap(const std::string &label, uint32_t seed, Weight max_step, Weight base) {
+        std::mt19937_64 generator(seed);
+        std::uniform_int_distribution<Weight> step_distribution(0, max_step);
+        std::uniform_int_distribution<graph::VertexId> vertex_distribution(0, 1000);
+
+        graph::RadixHeap<Weight> heap;
+        for (int run = 0; run < 2; ++run) {
+            // Вторая серия проверяет, что Clear возвращает кучу в исходное состояние
+            heap.Clear();
+            std::multiset<std::pair<Weight, graph::VertexId>> expected;
+            Weight last = base;
+            size_t mismatch_count = 0;
+
+            for (int step = 0; step < 20000; ++step) {
+                const int push_count = expected.empty() ? 3 : static_cast<int>(generator() % 3);
+                for (int i = 0; i < push_count; ++i) {
+                    const Weight step_weight = step_distribution(generator);
+                    const Weight weight = std::numeric_limits<Weight>::max() - last < step_weight
+                                          ? std::numeric_limits<Weight>::max() : last + step_weight;
+                    const graph::VertexId vertex = vertex_distribution(generator);
+                    heap.Push(weight, vertex);
+                    expected.emplace(weight, vertex);
+                }
+
+                const auto item = heap.Pop();
+                const auto expected_it = expected.find(item);
+                if (item.first != expected.begin()->first || expected_it == expected.end()) {
+                    ++mismatch_count;
+                    break;
+                }
+                expected.erase(expected_it);
+                last = item.first;
+            }
+            while (!heap.Empty()) {
+                const auto item = heap.Pop();
+                const auto expected_it = expected.find(item);
+                if (expected_it == expected.end() || item.first != expected.begin()->first) {
+                    ++mismatch_count;
+                    break;
+                }
+                expected.erase(expected_it);
+            }
+            Check(mismatch_count == 0 && expected.empty(), label + ": wrong pop order"s);
+        }
+    }
+
+}
+
+int main() {
+    for (const uint32_t seed: {1, 2, 3}) {
+        const std::string label = "seed "s + std::to_string(seed);
+        TestRadixHeap<uint32_t>(label + ", ties"s, seed, 3, 0);
+        TestRadixHeap<uint32_t>(label + ", deciseconds"s, seed, 20000, 0);
+        TestRadixHeap<uint32_t>(label + ", near the maximum"s, seed, 1 << 20,
+                                std::numeric_limits<uint32_t>::max() - (1u << 30));
+        TestRadixHeap<uint64_t>(label + ", 64-bit keys"s, seed, uint64_t{1} << 40, 0);
+    }
+    return tests::Finish("heap_test"s);
+}
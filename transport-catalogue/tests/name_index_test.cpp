@@ -0,0 +1,80 @@
+#include "name_index.h"
+#include "test_utils.h"
+
+#include <string>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    using tests::Check;
+
+    std::vector<std::string> MakeNames(const std::string &prefix, size_t count) {
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            names.push_back(prefix + std::to_string(i));
+        }
+        return names;
+    }
+
+    // Строит функцию для названий prefix0..prefix{count-1}, проверяет каждое название, промахи,
+    // минимальность (ячеек столько же, сколько названий) и то, что функция переживает сохранение в базу
+    void TestSequentialNames(const std::string &prefix, size_t count) {
+        const auto names = MakeNames(prefix, count);
+        const auto get_name = [&names](uint32_t id) -> std::string_view {
+            return names[id];
+        };
+        const std::string label = prefix + "0.."s + prefix + std::to_string(count);
+
+        transport_catalogue::NameIndex built;
+        built.Build(names.size(), get_name);
+        const auto proto_name_index = built.Serialize();
+        Check(static_cast<size_t>(proto_name_index.slot_ids_size()) == count, label + ": one slot per name"s);
+        transport_catalogue::NameIndex loaded;
+        loaded.Deserialize(proto_name_index);
+
+        for (const auto *index: {&built, &loaded}) {
+            Check(index->GetNameCount() == count, label + ": name count"s);
+            for (uint32_t id = 0; id < count; ++id) {
+                const auto found = index->Find(names[id], get_name);
+                if (!found || *found != id) {
+                    Check(false, label + ": lookup of "s + names[id]);
+                    break;
+                }
+            }
+            Check(!index->Find(prefix + std::to_string(count), get_name), label + ": miss past the end"s);
+            Check(!index->Find("X"s + prefix, get_name), label + ": miss with another prefix"s);
+            Check(!index->Find(""sv, get_name), label + ": miss of empty name"s);
+        }
+    }
+
+    // Повторяющиеся названия не мешают построению, а находится последнее из них — как в словаре названий
+    void TestDuplicateNames() {
+        const std::vector<std::string> names = {"A"s, "B"s, "A"s, "C"s, "B"s, "A"s};
+        const auto get_name = [&names](uint32_t id) -> std::string_view {
+            return names[id];
+        };
+
+        transport_catalogue::NameIndex index;
+        index.Build(names.size(), get_name);
+        Check(index.GetNameCount() == names.size(), "duplicates: name count"s);
+        Check(index.Serialize().slot_ids_size() == 3, "duplicates: one slot per distinct name"s);
+        Check(index.Find("A"sv, get_name) == 5u, "duplicates: last A"s);
+        Check(index.Find("B"sv, get_name) == 4u, "duplicates: last B"s);
+        Check(index.Find("C"sv, get_name) == 3u, "duplicates: single C"s);
+        Check(!index.Find("D"sv, get_name), "duplicates: miss"s);
+    }
+
+}
+
+int main() {
+    for (const size_t count: {0, 1, 2, 29, 30, 79, 80, 999, 1000, 10000, 100000}) {
+        TestSequentialNames("S"s, count);
+        TestSequentialNames("B"s, count);
+        TestSequentialNames("Stop "s, count);
+    }
+    TestDuplicateNames();
+    return tests::Finish("name_index_test"s);
+}
@@ -0,0 +1,321 @@
+#include "router.h"
+#include "test_city.h"
+#include "test_utils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace std::literals;
+
+namespace {
+
+    using tests::Check;
+    using tests::CheckThrows;
+    using tests::IsRouteValid;
+    using tests::IsSameWeight;
+
+    // Параллельное построение таблицы должно совпасть с последовательным побитово: веса и последние
+    // рёбра всех ячеек, а значит и маршруты. Сами маршруты — настоящие пути своего веса
+    template<typename Weight>
+    void TestParallelTable(const std::string &label, uint32_t seed, size_t stop_count, size_t bus_count) {
+        const auto city = tests::MakeCity<Weight>(seed, stop_count, bus_count).graph;
+        const graph::Router<Weight> sequential(city, 0);
+        const std::string expected_table = sequential.SerializePacked().SerializeAsString();
+
+        for (const size_t thread_count: {1, 2, 3, 4}) {
+            const graph::Router<Weight> parallel(city, thread_count);
+            Check(parallel.SerializePacked().SerializeAsString() == expected_table,
+                  label + ": table built on "s + std::to_string(thread_count) + " threads differs"s);
+
+            size_t mismatch_count = 0;
+            for (graph::VertexId from = 0; from < stop_count; ++from) {
+                for (graph::VertexId to = 0; to < stop_count; ++to) {
+                    const auto expected = sequential.BuildRoute(from, to);
+                    const auto route = parallel.BuildRoute(from, to);
+                    bool is_same = expected.has_value() == route.has_value();
+                    if (is_same && route) {
+                        is_same = expected->weight == route->weight && expected->edges == route->edges
+                                  && IsRouteValid(city, from, to, *route);
+                    }
+                    if (!is_same) {
+                        ++mismatch_count;
+                    }
+                }
+            }
+            Check(mismatch_count == 0, label + ": "s + std::to_string(mismatch_count) + " route mismatches on "s
+                                       + std::to_string(thread_count) + " threads"s);
+        }
+    }
+
+    // Граф на vertex_count вершинах из рёбер edges в случайном порядке. old_edge_ids[i] — прежний номер
+    // ребра edges[i] или NO_EDGE; edge_mapping получает новый номер каждого из old_edge_count прежних рёбер
+    template<typename Weight>
+    graph::DirectedWeightedGraph<Weight> ShuffleEdges(size_t vertex_count, std::vector<graph::Edge<Weight>> edges,
+                                                      const std::vector<graph::EdgeId> &old_edge_ids,
+                                                      size_t old_edge_count, std::mt19937 &generator,
+                                                      std::vector<graph::EdgeId> &edge_mapping) {
+        std::vector<size_t> order(edges.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), generator);
+        std::vector<graph::Edge<Weight>> shuffled_edges;
+        edge_mapping.assign(old_edge_count, graph::NO_EDGE);
+        for (const size_t index: order) {
+            if (old_edge_ids[index] != graph::NO_EDGE) {
+                edge_mapping[old_edge_ids[index]] = shuffled_edges.size();
+            }
+            shuffled_edges.push_back(edges[index]);
+        }
+        return graph::DirectedWeightedGraph<Weight>(vertex_count, std::move(shuffled_edges));
+    }
+
+    // Граф на тех же вершинах, где часть рёбер удалена, часть перевешена и добавлены новые;
+    // рёбра перемешаны. edge_mapping — новый номер каждого прежнего ребра или NO_EDGE
+    template<typename Weight>
+    graph::DirectedWeightedGraph<Weight> ChangeGraph(const graph::DirectedWeightedGraph<Weight> &old_graph,
+                                                     std::mt19937 &generator,
+                                                     std::vector<graph::EdgeId> &edge_mapping) {
+        std::uniform_real_distribution<double> unit_distribution(0.0, 1.0);
+        std::uniform_int_distribution<graph::VertexId> vertex_distribution(0, old_graph.GetVertexCount() - 1);
+
+        std::vector<graph::Edge<Weight>> edges;
+        std::vector<graph::EdgeId> old_edge_ids;
+        for (graph::EdgeId edge_id = 0; edge_id < old_graph.GetEdgeCount(); ++edge_id) {
+            auto edge = old_graph.GetEdge(edge_id);
+            const double action = unit_distribution(generator);
+            if (action < 0.05) {
+                continue;
+            }
+            if (action < 0.1) {
+                edge.weight = static_cast<Weight>(edge.weight * (0.5 + unit_distribution(generator))) + Weight{1};
+                old_edge_ids.push_back(graph::NO_EDGE);
+            } else {
+                old_edge_ids.push_back(edge_id);
+            }
+            edges.push_back(edge);
+        }
+        for (size_t i = 0; i < old_graph.GetEdgeCount() / 50; ++i) {
+            const auto edge = old_graph.GetEdge(generator() % old_graph.GetEdgeCount());
+            edges.push_back({vertex_distribution(generator), vertex_distribution(generator), edge.weight});
+            old_edge_ids.push_back(graph::NO_EDGE);
+        }
+        return ShuffleEdges(old_graph.GetVertexCount(), std::move(edges), old_edge_ids, old_graph.GetEdgeCount(),
+                            generator, edge_mapping);
+    }
+
+    // Граф, где часть вершин удалена вместе с рёбрами, добавлены новые вершины с рёбрами к прежним,
+    // а вершины перенумерованы. vertex_mapping — новый номер каждой прежней вершины или NO_VERTEX
+    template<typename Weight>
+    graph::DirectedWeightedGraph<Weight> ChangeVertices(const graph::DirectedWeightedGraph<Weight> &old_graph,
+                                                        std::mt19937 &generator,
+                                                        std::vector<graph::VertexId> &vertex_mapping,
+                                                        std::vector<graph::EdgeId> &edge_mapping) {
+        std::uniform_real_distribution<double> unit_distribution(0.0, 1.0);
+        const size_t old_vertex_count = old_graph.GetVertexCount();
+
+        std::vector<bool> is_kept(old_vertex_count);
+        size_t kept_count = 0;
+        for (size_t vertex = 0; vertex < old_vertex_count; ++vertex) {
+            is_kept[vertex] = unit_distribution(generator) >= 0.1;
+            kept_count += is_kept[vertex];
+        }
+        const size_t vertex_count = kept_count + old_vertex_count / 8;
+        std::vector<graph::VertexId> new_ids(vertex_count);
+        std::iota(new_ids.begin(), new_ids.end(), 0);
+        std::shuffle(new_ids.begin(), new_ids.end(), generator);
+        vertex_mapping.assign(old_vertex_count, graph::NO_VERTEX);
+        for (size_t vertex = 0, next_id = 0; vertex < old_vertex_count; ++vertex) {
+            if (is_kept[vertex]) {
+                vertex_mapping[vertex] = new_ids[next_id++];
+            }
+        }
+
+        std::vector<graph::Edge<Weight>> edges;
+        std::vector<graph::EdgeId> old_edge_ids;
+        for (graph::EdgeId edge_id = 0; edge_id < old_graph.GetEdgeCount(); ++edge_id) {
+            const auto edge = old_graph.GetEdge(edge_id);
+            const graph::VertexId from = vertex_mapping[edge.from];
+            const graph::VertexId to = vertex_mapping[edge.to];
+            if (from != graph::NO_VERTEX && to != graph::NO_VERTEX && unit_distribution(generator) >= 0.05) {
+                edges.push_back({from, to, edge.weight});
+                old_edge_ids.push_back(edge_id);
+            }
+        }
+        std::uniform_int_distribution<graph::VertexId> vertex_distribution(0, vertex_count - 1);
+        for (size_t i = kept_count; i < vertex_count; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                const auto edge = old_graph.GetEdge(generator() % old_graph.GetEdgeCount());
+                edges.push_back({new_ids[i], vertex_distribution(generator), edge.weight});
+                edges.push_back({vertex_distribution(generator), new_ids[i], edge.weight});
+                old_edge_ids.push_back(graph::NO_EDGE);
+                old_edge_ids.push_back(graph::NO_EDGE);
+            }
+        }
+        return ShuffleEdges(vertex_count, std::move(edges), old_edge_ids, old_graph.GetEdgeCount(), generator,
+                            edge_mapping);
+    }
+
+    // Пары вершин, где маршрут router не совпадает по весу с маршрутом expected_router или не является путём
+    template<typename Weight>
+    size_t CountMismatches(const graph::DirectedWeightedGraph<Weight> &graph,
+                           const graph::Router<Weight> &expected_router, const graph::Router<Weight> &router) {
+        size_t mismatch_count = 0;
+        for (graph::VertexId from = 0; from < graph.GetVertexCount(); ++from) {
+            for (graph::VertexId to = 0; to < graph.GetVertexCount(); ++to) {
+                const auto expected = expected_router.BuildRoute(from, to);
+                const auto route = router.BuildRoute(from, to);
+                bool is_same = expected.has_value() == route.has_value();
+                if (is_same && route) {
+                    is_same = IsSameWeight(expected->weight, route->weight) && IsRouteValid(graph, from, to, *route);
+                }
+                if (!is_same) {
+                    ++mismatch_count;
+                }
+            }
+        }
+        return mismatch_count;
+    }
+
+    // Таблица, починенная Update после нескольких изменений графа, совпадает по весам
+    // с построенной заново, а её маршруты — настоящие пути нового графа
+    template<typename Weight>
+    void TestUpdate(const std::string &label, uint32_t seed, size_t stop_count, size_t bus_count) {
+        std::mt19937 generator(seed);
+        auto city = tests::MakeCity<Weight>(seed, stop_count, bus_count).graph;
+        graph::Router<Weight> router(city);
+
+        std::vector<graph::EdgeId> edge_mapping(city.GetEdgeCount());
+        std::iota(edge_mapping.begin(), edge_mapping.end(), 0);
+        Check(router.Update(edge_mapping) == 0, label + ": unchanged graph repairs labels"s);
+
+        for (int round = 0; round < 3; ++round) {
+            city = ChangeGraph(city, generator, edge_mapping);
+            router.Update(edge_mapping);
+            const graph::Router<Weight> rebuilt(city);
+            const size_t mismatch_count = CountMismatches(city, rebuilt, router);
+            Check(mismatch_count == 0, label + ": "s + std::to_string(mismatch_count) + " mismatches after update "s
+                                       + std::to_string(round + 1));
+        }
+    }
+
+    // То же, когда вершины удаляются, добавляются и перенумеровываются
+    template<typename Weight>
+    void TestVertexUpdate(const std::string &label, uint32_t seed, size_t stop_count, size_t bus_count) {
+        std::mt19937 generator(seed);
+        auto city = tests::MakeCity<Weight>(seed, stop_count, bus_count).graph;
+        graph::Router<Weight> router(city);
+
+        std::vector<graph::VertexId> vertex_mapping;
+        std::vector<graph::EdgeId> edge_mapping;
+        for (int round = 0; round < 3; ++round) {
+            city = ChangeVertices(city, generator, vertex_mapping, edge_mapping);
+            router.Update(vertex_mapping, edge_mapping);
+            const graph::Router<Weight> rebuilt(city);
+            const size_t mismatch_count = CountMismatches(city, rebuilt, router);
+            Check(mismatch_count == 0, label + ": "s + std::to_string(mismatch_count)
+                                       + " mismatches after vertex update "s + std::to_string(round + 1));
+        }
+    }
+
+    // Граф с несогласованными массивами CSR отвергается при загрузке
+    template<typename Weight>
+    void TestCorruptedGraph(const std::string &label) {
+        const auto city = tests::MakeCity<Weight>(1, 40, 15).graph;
+        const auto proto_graph = city.Serialize();
+        const auto check_rejected = [&label](const transport_catalogue_protobuf::Graph &broken_graph,
+                                             const std::string &message) {
+            CheckThrows([&] { graph::DirectedWeightedGraph<Weight>().Deserialize(broken_graph); },
+                        label + ": "s + message);
+        };
+
+        graph::DirectedWeightedGraph<Weight> loaded;
+        loaded.Deserialize(proto_graph);
+        Check(loaded.GetEdgeCount() == city.GetEdgeCount(), label + ": intact graph loads"s);
+
+        auto broken_graph = proto_graph;
+        broken_graph.set_edge_ids(0, proto_graph.edge_ids_size());
+        check_rejected(broken_graph, "edge id past the arcs"s);
+        broken_graph = proto_graph;
+        broken_graph.set_edge_ids(0, proto_graph.edge_ids(1));
+        check_rejected(broken_graph, "repeated edge id"s);
+        broken_graph = proto_graph;
+        broken_graph.set_offsets(1, proto_graph.offsets(2) + 1);
+        check_rejected(broken_graph, "decreasing offsets"s);
+        broken_graph = proto_graph;
+        broken_graph.set_offsets(proto_graph.offsets_size() - 1, proto_graph.edge_ids_size() - 1);
+        check_rejected(broken_graph, "last offset before the end of arcs"s);
+        broken_graph = proto_graph;
+        broken_graph.set_targets(0, city.GetVertexCount());
+        check_rejected(broken_graph, "arc to a missing vertex"s);
+        broken_graph = proto_graph;
+        broken_graph.mutable_targets()->RemoveLast();
+        check_rejected(broken_graph, "short targets"s);
+        broken_graph = proto_graph;
+        if constexpr (std::is_integral_v<Weight>) {
+            broken_graph.mutable_integer_weights()->RemoveLast();
+        } else {
+            broken_graph.mutable_weights()->RemoveLast();
+        }
+        check_rejected(broken_graph, "short weights"s);
+    }
+
+    // Таблица, сохранённая для одного графа, в любом формате не загружается для другого и с битым ребром
+    template<typename Weight>
+    void TestMismatchedTable(const std::string &label) {
+        const auto city = tests::MakeCity<Weight>(1, 80, 30).graph;
+        const auto other_city = tests::MakeCity<Weight>(2, 40, 15).graph;
+        const graph::Router<Weight> router(city);
+
+        for (const auto &proto_table: {router.Serialize(), router.SerializePacked()}) {
+            const std::string format = proto_table.routes_internal_data().empty() ? " packed"s : " nested"s;
+            CheckThrows([&] { graph::Router<Weight>(other_city, proto_table); },
+                        label + format + ": table of another graph"s);
+
+            auto broken_table = proto_table;
+            const graph::EdgeId missing_edge = city.GetEdgeCount();
+            if (broken_table.routes_internal_data().empty()) {
+                broken_table.set_prev_edges(0, missing_edge + 1);
+            } else {
+                auto *route = broken_table.mutable_routes_internal_data(0)->mutable_optional_route_internal_data_vector(0);
+                route->set_is_present(true);
+                route->mutable_route_internal_data()->set_prev_edge(missing_edge);
+                route->mutable_route_internal_data()->set_has_prev_edge(true);
+            }
+            CheckThrows([&] { graph::Router<Weight>(city, broken_table); }, label + format + ": missing edge"s);
+        }
+
+        auto short_row = router.Serialize();
+        short_row.mutable_routes_internal_data(1)->mutable_optional_route_internal_data_vector()->RemoveLast();
+        CheckThrows([&] { graph::Router<Weight>(city, short_row); }, label + " nested: short row"s);
+    }
+
+}
+
+int main() {
+    for (const uint32_t seed: {1, 2, 3}) {
+        const std::string label = "seed "s + std::to_string(seed);
+        TestParallelTable<double>(label + ", double weights"s, seed, 150, 60);
+        TestParallelTable<uint32_t>(label + ", integer weights"s, seed, 150, 60);
+    }
+    TestParallelTable<double>("sparse city"s, 4, 300, 20);
+    for (const uint32_t seed: {1, 2, 3}) {
+        const std::string label = "update, seed "s + std::to_string(seed);
+        TestUpdate<double>(label + ", double weights"s, seed, 120, 50);
+        TestUpdate<uint32_t>(label + ", integer weights"s, seed, 120, 50);
+    }
+    TestUpdate<double>("update, sparse city"s, 4, 200, 15);
+    for (const uint32_t seed: {1, 2, 3}) {
+        const std::string label = "vertex update, seed "s + std::to_string(seed);
+        TestVertexUpdate<double>(label + ", double weights"s, seed, 120, 50);
+        TestVertexUpdate<uint32_t>(label + ", integer weights"s, seed, 120, 50);
+    }
+    TestCorruptedGraph<double>("corrupted graph, double weights"s);
+    TestCorruptedGraph<uint32_t>("corrupted graph, integer weights"s);
+    TestMismatchedTable<double>("double weights"s);
+    TestMismatchedTable<uint32_t>("integer weights"s);
+    return tests::Finish("router_test"s);
+}
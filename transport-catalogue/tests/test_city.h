@@ -0,0 +1,155 @@
+#pragma once
+
+#include "geo.h"
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tests {
+
+    // Случайный город: остановки с координатами и маршруты по ним, у части маршрутов — расписание
+    // отправлений в минутах. Соседние остановки маршрута различны, у кольцевого последняя совпадает
+    // с первой. Расстояние между соседними остановками задаётся в каждую сторону отдельно,
+    // не короче прямого и кратно 100 м, поэтому находятся разные пути одного веса
+    struct CityPlan {
+        struct Line {
+            std::vector<size_t> stops;
+            bool is_circled = false;
+            std::vector<double> departures;
+        };
+
+        std::vector<geo::Coordinates> coordinates;
+        std::vector<Line> lines;
+        std::map<std::pair<size_t, size_t>, int> distances;
+    };
+
+    inline CityPlan MakeCityPlan(uint32_t seed, size_t stop_count, size_t bus_count) {
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<size_t> stop_distribution(0, stop_count - 1);
+        std::uniform_int_distribution<size_t> length_distribution(2, 10);
+        std::uniform_real_distribution<double> unit_distribution(0.0, 1.0);
+
+        CityPlan plan;
+        for (size_t stop = 0; stop < stop_count; ++stop) {
+            plan.coordinates.push_back({55.6 + 0.1 * unit_distribution(generator),
+                                        37.5 + 0.15 * unit_distribution(generator)});
+        }
+
+        auto add_distance = [&](size_t from, size_t to) {
+            if (plan.distances.count({from, to}) == 0) {
+                const double direct = geo::ComputeDistance(plan.coordinates[from], plan.coordinates[to]);
+                plan.distances[{from, to}] = static_cast<int>(
+                        std::ceil(direct * (1.0 + 0.5 * unit_distribution(generator)) / 100.0) * 100.0);
+            }
+        };
+
+        for (size_t bus = 0; bus < bus_count; ++bus) {
+            CityPlan::Line line{{stop_distribution(generator)}, unit_distribution(generator) < 0.3, {}};
+            for (size_t length = length_distribution(generator); line.stops.size() < length;) {
+                const size_t stop = stop_distribution(generator);
+                if (stop != line.stops.back()) {
+                    line.stops.push_back(stop);
+                }
+            }
+            if (line.is_circled) {
+                line.stops.push_back(line.stops.front());
+            }
+            for (size_t i = 0; i + 1 < line.stops.size(); ++i) {
+                add_distance(line.stops[i], line.stops[i + 1]);
+                add_distance(line.stops[i + 1], line.stops[i]);
+            }
+            if (unit_distribution(generator) < 0.7) {
+                for (size_t i = 0, count = length_distribution(generator) / 2; i < count; ++i) {
+                    line.departures.push_back(std::floor(600.0 * unit_distribution(generator)));
+                }
+            }
+            plan.lines.push_back(std::move(line));
+        }
+        return plan;
+    }
+
+    template<typename Weight>
+    struct City {
+        graph::DirectedWeightedGraph<Weight> graph;
+        // Координаты остановки-вершины и нижняя оценка веса на метр по прямой — для A*
+        std::vector<geo::Coordinates> coordinates;
+        double weight_per_meter = 0;
+    };
+
+    // Граф города из MakeCityPlan как в TransportRouter: ребро из остановки маршрута в каждую следующую,
+    // вес — ожидание плюс время в пути по перегонам. Некольцевой маршрут проезжается туда и обратно
+    // двумя отдельными участками. Целые веса — децисекунды, как в TransportRouter
+    template<typename Weight>
+    City<Weight> MakeCity(uint32_t seed, size_t stop_count, size_t bus_count) {
+        const double wait_time = 6.0;
+        const double velocity = 40.0 * 1000.0 / 60.0;
+        const double scale = std::is_integral_v<Weight> ? 600.0 : 1.0;
+
+        auto plan = MakeCityPlan(seed, stop_count, bus_count);
+        City<Weight> city{graph::DirectedWeightedGraph<Weight>(stop_count), std::move(plan.coordinates),
+                          scale / velocity};
+
+        auto add_range = [&](const std::vector<size_t> &stops) {
+            for (size_t from = 0; from < stops.size(); ++from) {
+                double time = wait_time;
+                for (size_t to = from + 1; to < stops.size(); ++to) {
+                    time += plan.distances.at({stops[to - 1], stops[to]}) / velocity;
+                    if (stops[from] == stops[to]) {
+                        continue;
+                    }
+                    const auto vertex_from = static_cast<graph::VertexId>(stops[from]);
+                    const auto vertex_to = static_cast<graph::VertexId>(stops[to]);
+                    if constexpr (std::is_integral_v<Weight>) {
+                        city.graph.AddEdge({vertex_from, vertex_to, static_cast<Weight>(std::lround(time * scale))});
+                    } else {
+                        city.graph.AddEdge({vertex_from, vertex_to, time});
+                    }
+                }
+            }
+        };
+
+        for (const auto &line: plan.lines) {
+            add_range(line.stops);
+            if (!line.is_circled) {
+                add_range({line.stops.rbegin(), line.stops.rend()});
+            }
+        }
+        city.graph.Freeze();
+        return city;
+    }
+
+    template<typename Weight>
+    bool IsSameWeight(Weight lhs, Weight rhs) {
+        if constexpr (std::is_integral_v<Weight>) {
+            return lhs == rhs;
+        } else {
+            return std::abs(lhs - rhs) <= 1e-9 * std::max<Weight>(1, std::abs(lhs));
+        }
+    }
+
+    // Маршрут — цепочка рёбер из from в to, и его вес равен сумме весов рёбер
+    template<typename Weight>
+    bool IsRouteValid(const graph::DirectedWeightedGraph<Weight> &graph, graph::VertexId from, graph::VertexId to,
+                      const typename graph::RouteBuilder<Weight>::RouteInfo &route) {
+        graph::VertexId vertex = from;
+        Weight weight{};
+        for (const auto edge_id: route.edges) {
+            const auto edge = graph.GetEdge(edge_id);
+            if (edge.from != vertex) {
+                return false;
+            }
+            vertex = edge.to;
+            weight += edge.weight;
+        }
+        return vertex == to && IsSameWeight(weight, route.weight);
+    }
+
+}  // namespace tests
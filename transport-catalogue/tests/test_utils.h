@@ -0,0 +1,39 @@
+#pragma once
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace tests {
+
+    // Общая обвязка тестов: Check копит проваленные проверки, Finish возвращает код выхода для main
+    inline int failure_count = 0;
+
+    inline void Check(bool condition, const std::string &message) {
+        if (!condition) {
+            std::cerr << "FAILED: " << message << std::endl;
+            ++failure_count;
+        }
+    }
+
+    // Загрузка негодных данных должна отвергаться исключением, а не читать за границами массивов
+    template<typename Function>
+    void CheckThrows(Function function, const std::string &message) {
+        try {
+            function();
+        } catch (const std::runtime_error &) {
+            return;
+        }
+        Check(false, message);
+    }
+
+    inline int Finish(const std::string &test_name) {
+        if (failure_count > 0) {
+            std::cerr << test_name << ": " << failure_count << " checks failed" << std::endl;
+            return 1;
+        }
+        std::cerr << test_name << ": OK" << std::endl;
+        return 0;
+    }
+
+}  // namespace tests
@@ -0,0 +1,413 @@
+#include "test_city.h"
+#include "test_utils.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+using namespace std::literals;
+using namespace transport_catalogue;
+
+namespace {
+
+    using tests::Check;
+
+    const int WAIT_TIME = 6;
+    const double BUS_VELOCITY = 40.0;
+    const double WEIGHT_UNITS_PER_MINUTE = std::is_integral_v<RouteWeight> ? 600.0 : 1.0;
+
+    using Route = std::vector<std::variant<BusItem, WaitItem>>;
+
+    // Рейс автобуса: номера остановок по порядку проезда и расстояние от начала до каждой
+    struct Trip {
+        std::vector<size_t> stops;
+        std::vector<int64_t> distances;
+        double departure_time = 0;
+    };
+
+    struct City {
+        TransportCatalogue db;
+        std::vector<Trip> trips;
+    };
+
+    // Справочник города из tests::MakeCityPlan. Рейсы собираются по исходным данным, мимо справочника.
+    // Доля zero_distance_share расстояний обнуляется — такие перегоны проезжаются мгновенно
+    City MakeCity(uint32_t seed, size_t stop_count, size_t bus_count, double zero_distance_share = 0) {
+        auto plan = tests::MakeCityPlan(seed, stop_count, bus_count);
+        std::mt19937 generator(seed);
+        std::bernoulli_distribution zero_distribution(zero_distance_share);
+        for (auto &[stop_pair, distance]: plan.distances) {
+            if (zero_distribution(generator)) {
+                distance = 0;
+            }
+        }
+
+        City city;
+        auto &db = city.db;
+        std::vector<InputStopInfo> stops;
+        for (size_t stop = 0; stop < stop_count; ++stop) {
+            stops.push_back({"Stop "s + std::to_string(stop), plan.coordinates[stop]});
+            db.AddStop(&stops.back(), std::nullopt);
+        }
+
+        for (size_t bus = 0; bus < plan.lines.size(); ++bus) {
+            const auto &line = plan.lines[bus];
+            InputBusInfo bus_info{"Bus "s + std::to_string(bus), {}, line.is_circled};
+            for (const size_t stop: line.stops) {
+                bus_info.stops.push_back(stops[stop].stop_name);
+            }
+            bus_info.departures = line.departures;
+            db.AddBus(&bus_info, std::nullopt);
+
+            // Некольцевой маршрут проезжается туда и обратно
+            Trip trip{line.stops, {0}};
+            if (!line.is_circled) {
+                trip.stops.insert(trip.stops.end(), std::next(line.stops.rbegin()), line.stops.rend());
+            }
+            for (size_t i = 0; i + 1 < trip.stops.size(); ++i) {
+                const int distance = plan.distances.at({trip.stops[i], trip.stops[i + 1]});
+                trip.distances.push_back(trip.distances.back() + distance);
+            }
+            for (const double departure_time: line.departures) {
+                trip.departure_time = departure_time;
+                city.trips.push_back(trip);
+            }
+        }
+
+        for (const auto &[stop_pair, distance]: plan.distances) {
+            const InputDistanceInfo distance_info{stops[stop_pair.first].stop_name,
+                                                  {{stops[stop_pair.second].stop_name, distance}}};
+            db.AddRealDistance(&distance_info);
+        }
+        db.Freeze();
+        return city;
+    }
+
+    // База, сохранённая без статистики маршрутов (как до её появления), отвечает на запросы Bus так же
+    void TestBusStatsOfOldBase(const std::string &label, uint32_t seed, size_t stop_count, size_t bus_count) {
+        const auto db = MakeCity(seed, stop_count, bus_count).db;
+        auto proto_db = db.Serialize();
+        for (auto &proto_bus: *proto_db.mutable_buses()->mutable_buses()) {
+            proto_bus.clear_route_length();
+            proto_bus.clear_real_length();
+            proto_bus.clear_curvature();
+        }
+        TransportCatalogue loaded_db;
+        loaded_db.Deserialize(proto_db);
+
+        size_t mismatch_count = 0;
+        for (const Bus *bus: db.GetAllBuses()) {
+            const auto expected = db.GetBusInfo(bus->bus_name);
+            const auto info = loaded_db.GetBusInfo(bus->bus_name);
+            if (!info || info->route_length != expected->route_length || info->real_length != expected->real_length
+                || info->curvature != expected->curvature) {
+                ++mismatch_count;
+            }
+        }
+        Check(mismatch_count == 0, label + ": "s + std::to_string(mismatch_count) + " bus stats mismatches"s);
+    }
+
+    void FillRouter(TransportRouter &router, const TransportCatalogue &db, RouterEngine engine, GraphModel model) {
+        router.SetBusWaitTime(WAIT_TIME);
+        router.SetBusVelocity(BUS_VELOCITY);
+        router.SetRouterEngine(engine);
+        router.SetGraphModel(model);
+        router.SetDb(db);
+        router.FillGraph();
+    }
+
+    // Маршрут — чередование ожидания и поездки, начиная с ожидания
+    bool IsRouteWellFormed(const Route &route) {
+        for (size_t i = 0; i < route.size(); ++i) {
+            if (std::holds_alternative<WaitItem>(route[i]) != (i % 2 == 0)) {
+                return false;
+            }
+        }
+        return route.size() % 2 == 0;
+    }
+
+    double GetRouteTime(const Route &route) {
+        double time = 0;
+        for (const auto &item: route) {
+            time += std::visit([](const auto &value) { return value.time; }, item);
+        }
+        return time;
+    }
+
+    int GetRouteSpan(const Route &route) {
+        int span = 0;
+        for (const auto &item: route) {
+            if (const auto bus_item = std::get_if<BusItem>(&item)) {
+                span += bus_item->span;
+            }
+        }
+        return span;
+    }
+
+    // С целыми весами время каждого ребра округлено вверх до децисекунды, и модели графа и движки
+    // округляют по-разному: допуск — по децисекунде на каждый перегон обоих маршрутов
+    bool IsSameRouteTime(const Route &lhs, const Route &rhs) {
+        const double lhs_time = GetRouteTime(lhs);
+        const double rhs_time = GetRouteTime(rhs);
+        const double tolerance = std::is_integral_v<RouteWeight>
+                                 ? (GetRouteSpan(lhs) + GetRouteSpan(rhs)) / WEIGHT_UNITS_PER_MINUTE + 1e-9
+                                 : 1e-9 * std::max(1.0, std::abs(lhs_time));
+        return std::abs(lhs_time - rhs_time) <= tolerance;
+    }
+
+    // Время каждого маршрута совпадает с временем маршрута из expected_router
+    void CheckRoutes(const std::string &label, const TransportCatalogue &db, const TransportRouter &expected_router,
+                     const TransportRouter &router) {
+        size_t mismatch_count = 0;
+        for (size_t from = 0; from < db.GetLastStopId(); ++from) {
+            for (size_t to = 0; to < db.GetLastStopId(); ++to) {
+                const auto expected = expected_router.GetRoute(db.GetStopName(from), db.GetStopName(to));
+                const auto route = router.GetRoute(db.GetStopName(from), db.GetStopName(to));
+                bool is_same = expected.has_value() == route.has_value();
+                if (is_same && route) {
+                    is_same = IsRouteWellFormed(*route) && IsSameRouteTime(*expected, *route);
+                }
+                if (!is_same) {
+                    ++mismatch_count;
+                }
+            }
+        }
+        Check(mismatch_count == 0, label + ": "s + std::to_string(mismatch_count) + " route mismatches"s);
+    }
+
+    void TestGraphModels(const std::string &label, uint32_t seed, size_t stop_count, size_t bus_count) {
+        const auto db = MakeCity(seed, stop_count, bus_count).db;
+        TransportRouter span_router;
+        FillRouter(span_router, db, RouterEngine::DIJKSTRA, GraphModel::SPAN);
+
+        TransportRouter route_router;
+        FillRouter(route_router, db, RouterEngine::DIJKSTRA, GraphModel::ROUTE);
+        CheckRoutes(label + ", route model"s, db, span_router, route_router);
+
+        TransportRouter route_table_router;
+        FillRouter(route_table_router, db, RouterEngine::ALL_PAIRS, GraphModel::ROUTE);
+        CheckRoutes(label + ", route model with all pairs table"s, db, span_router, route_table_router);
+    }
+
+    // update_base с новым, изменённым и удалённым автобусом меняет число вершин графа, а таблица all_pairs,
+    // починенная UpdateDb, даёт те же времена, что и граф, построенный заново
+    void TestUpdateDb(const std::string &label, uint32_t seed, size_t stop_count, size_t bus_count, GraphModel model) {
+        auto db = MakeCity(seed, stop_count, bus_count).db;
+        TransportRouter router;
+        FillRouter(router, db, RouterEngine::ALL_PAIRS, model);
+
+        auto stop_name = [stop_count](size_t stop) {
+            return "Stop "s + std::to_string(stop_count - 1 - stop);
+        };
+        const InputBusInfo new_bus{"Bus new"s, {stop_name(0), stop_name(1), stop_name(2), stop_name(0)}, true};
+        db.UpdateBus(&new_bus);
+        const InputBusInfo changed_bus{"Bus 1"s, {stop_name(3), stop_name(1), stop_name(4)}, false};
+        db.UpdateBus(&changed_bus);
+        db.RemoveBus("Bus 0"sv);
+        for (size_t stop = 0; stop < 4; ++stop) {
+            const int distance = static_cast<int>(1'000 + 100 * stop);
+            const InputDistanceInfo distance_info{stop_name(stop), {{stop_name(stop + 1), distance}}};
+            db.AddRealDistance(&distance_info);
+        }
+        db.Freeze();
+        router.UpdateDb(db);
+
+        TransportRouter expected_router;
+        FillRouter(expected_router, db, RouterEngine::DIJKSTRA, GraphModel::SPAN);
+        CheckRoutes(label, db, expected_router, router);
+    }
+
+    // Компоненты остановок совпадают с достижимостью по маршрутам автобусов: остановки в одной компоненте
+    // тогда и только тогда, когда из первой можно доехать до второй. Остановка без автобусов — вне компонент
+    void TestStopComponents(const std::string &label, uint32_t seed, size_t stop_count, size_t bus_count) {
+        const auto db = MakeCity(seed, stop_count, bus_count).db;
+        TransportRouter router;
+        FillRouter(router, db, RouterEngine::DIJKSTRA, GraphModel::SPAN);
+        const auto proto_router = router.Serialize();
+        const auto &components = proto_router.stop_components();
+
+        std::vector<std::vector<size_t>> next_stops(db.GetLastStopId());
+        for (const Bus *bus: db.GetAllBuses()) {
+            const auto stop_ids = db.GetBusStopIds(bus->id);
+            for (auto it = stop_ids.begin(); std::next(it) != stop_ids.end(); ++it) {
+                next_stops[*it].push_back(*std::next(it));
+            }
+        }
+
+        const uint32_t no_component = std::numeric_limits<uint32_t>::max();
+        size_t mismatch_count = 0;
+        size_t component_pair_count = 0;
+        for (size_t from = 0; from < db.GetLastStopId(); ++from) {
+            std::vector<bool> is_reachable(db.GetLastStopId(), false);
+            std::vector<size_t> queue{from};
+            while (!queue.empty()) {
+                const size_t stop = queue.back();
+                queue.pop_back();
+                for (const size_t next_stop: next_stops[stop]) {
+                    if (!is_reachable[next_stop]) {
+                        is_reachable[next_stop] = true;
+                        queue.push_back(next_stop);
+                    }
+                }
+            }
+
+            if ((components[from] == no_component) != next_stops[from].empty()) {
+                ++mismatch_count;
+                continue;
+            }
+            for (size_t to = 0; to < db.GetLastStopId(); ++to) {
+                const bool is_same_component = components[from] != no_component && components[from] == components[to];
+                if (is_same_component != (is_reachable[to] || (from == to && !next_stops[from].empty()))) {
+                    ++mismatch_count;
+                }
+                component_pair_count += is_same_component && from != to ? 1 : 0;
+            }
+        }
+        Check(component_pair_count > 0, label + ": no connected stops to test"s);
+        Check(mismatch_count == 0, label + ": "s + std::to_string(mismatch_count) + " stop component mismatches"s);
+    }
+
+    // RAPTOR ищет прямо по маршрутам автобусов, без графа, и должен находить те же времена
+    void TestRaptor(const std::string &label, uint32_t seed, size_t stop_count, size_t bus_count) {
+        const auto db = MakeCity(seed, stop_count, bus_count).db;
+        TransportRouter span_router;
+        FillRouter(span_router, db, RouterEngine::DIJKSTRA, GraphModel::SPAN);
+
+        TransportRouter raptor_router;
+        FillRouter(raptor_router, db, RouterEngine::RAPTOR, GraphModel::SPAN);
+        CheckRoutes(label + ", raptor"s, db, span_router, raptor_router);
+    }
+
+    // Самые ранние приезды перебором: на рейс можно сесть там, куда успели до его отправления,
+    // и проходы по всем рейсам повторяются, пока приезды улучшаются
+    std::vector<double> FindEarliestArrivals(const City &city, size_t stop_from_id, double departure_time) {
+        const double bus_velocity = BUS_VELOCITY * 1'000.0 / 60.0;
+        std::vector<double> arrival_times(city.db.GetLastStopId(), std::numeric_limits<double>::infinity());
+        arrival_times[stop_from_id] = departure_time;
+
+        for (bool is_changed = true; is_changed;) {
+            is_changed = false;
+            for (const auto &trip: city.trips) {
+                bool is_boarded = false;
+                for (size_t i = 0; i < trip.stops.size(); ++i) {
+                    const double time = trip.departure_time + trip.distances[i] / bus_velocity;
+                    auto &arrival_time = arrival_times[trip.stops[i]];
+                    if (is_boarded && time < arrival_time) {
+                        arrival_time = time;
+                        is_changed = true;
+                    }
+                    is_boarded = is_boarded || arrival_time <= time;
+                }
+            }
+        }
+        return arrival_times;
+    }
+
+    // Приезд по маршруту Connection Scan — отправление плюс время всех ожиданий и поездок —
+    // совпадает с самым ранним приездом перебором
+    void TestTimetable(const std::string &label, uint32_t seed, size_t stop_count, size_t bus_count,
+                       double zero_distance_share = 0) {
+        const auto city = MakeCity(seed, stop_count, bus_count, zero_distance_share);
+        const auto &db = city.db;
+        TransportRouter router;
+        FillRouter(router, db, RouterEngine::DIJKSTRA, GraphModel::SPAN);
+
+        std::mt19937 generator(seed);
+        std::uniform_real_distribution<double> departure_distribution(0.0, 700.0);
+        size_t mismatch_count = 0;
+        size_t route_count = 0;
+        for (size_t from = 0; from < stop_count; ++from) {
+            const double departure_time = departure_distribution(generator);
+            const auto arrival_times = FindEarliestArrivals(city, from, departure_time);
+            for (size_t to = 0; to < stop_count; ++to) {
+                const auto route = router.GetTimetableRoute(db.GetStopName(from), db.GetStopName(to), departure_time);
+                bool is_same = route.has_value() == (arrival_times[to] != std::numeric_limits<double>::infinity());
+                if (is_same && route) {
+                    is_same = IsRouteWellFormed(*route) && std::abs(departure_time + GetRouteTime(*route) -
+                                                                    arrival_times[to]) <= 1e-9 * arrival_times[to];
+                    ++route_count;
+                }
+                if (!is_same) {
+                    ++mismatch_count;
+                }
+            }
+        }
+        Check(route_count > stop_count, label + ": too few timetable routes to test"s);
+        Check(mismatch_count == 0, label + ": "s + std::to_string(mismatch_count) + " timetable route mismatches"s);
+    }
+
+    // Пересадка в момент отправления: рейс "A-B" за нулевое время довозит до B, откуда в ту же минуту
+    // уходит рейс "B-C-D", добавленный раньше. Перегон B-C длины transfer_distance — при нулевой длине
+    // вся цепочка до C тоже занимает ноль минут
+    void TestInstantTransfer(const std::string &label, int transfer_distance) {
+        const double departure_time = 10;
+        const int last_distance = 1000;
+
+        TransportCatalogue db;
+        std::vector<InputStopInfo> stops;
+        for (const auto &name: {"A"s, "B"s, "C"s, "D"s}) {
+            stops.push_back({name, {55.6, 37.6 + 0.01 * static_cast<double>(stops.size())}});
+        }
+        for (const auto &stop: stops) {
+            db.AddStop(&stop, std::nullopt);
+        }
+        InputBusInfo late_bus{"B-C-D"s, {"B"s, "C"s, "D"s}, false, {departure_time}};
+        db.AddBus(&late_bus, std::nullopt);
+        InputBusInfo early_bus{"A-B"s, {"A"s, "B"s}, false, {departure_time}};
+        db.AddBus(&early_bus, std::nullopt);
+        for (const InputDistanceInfo &distance_info: {InputDistanceInfo{"A"s, {{"B"s, 0}}},
+                                                      InputDistanceInfo{"B"s, {{"C"s, transfer_distance}}},
+                                                      InputDistanceInfo{"C"s, {{"D"s, last_distance}}}}) {
+            db.AddRealDistance(&distance_info);
+        }
+        db.Freeze();
+
+        TransportRouter router;
+        FillRouter(router, db, RouterEngine::DIJKSTRA, GraphModel::SPAN);
+        const double meters_per_minute = BUS_VELOCITY * 1000.0 / 60.0;
+        for (const auto &[to, distance]: {std::pair{"C"s, transfer_distance},
+                                          std::pair{"D"s, transfer_distance + last_distance}}) {
+            const auto route = router.GetTimetableRoute("A"s, to, departure_time);
+            Check(route && IsRouteWellFormed(*route) &&
+                  std::abs(GetRouteTime(*route) - distance / meters_per_minute) <= 1e-9,
+                  label + ": wrong timetable route from A to "s + to);
+        }
+    }
+
+}
+
+int main() {
+    for (const uint32_t seed: {1, 2, 3}) {
+        TestGraphModels("seed "s + std::to_string(seed), seed, 80, 30);
+        TestRaptor("seed "s + std::to_string(seed), seed, 80, 30);
+        TestTimetable("timetable, seed "s + std::to_string(seed), seed, 80, 30);
+    }
+    TestGraphModels("sparse city"s, 4, 150, 12);
+    TestStopComponents("stop components, seed 1"s, 1, 80, 30);
+    TestStopComponents("stop components, sparse city"s, 4, 150, 12);
+    TestRaptor("sparse city"s, 4, 150, 12);
+    TestTimetable("timetable, sparse city"s, 4, 150, 12);
+    for (const uint32_t seed: {1, 2}) {
+        TestTimetable("timetable, zero distances, seed "s + std::to_string(seed), seed, 80, 30, 0.3);
+    }
+    TestInstantTransfer("instant transfer"s, 1000);
+    TestInstantTransfer("instant transfer chain"s, 0);
+    TestBusStatsOfOldBase("old base"s, 1, 80, 30);
+    for (const uint32_t seed: {1, 2}) {
+        TestUpdateDb("update, span model, seed "s + std::to_string(seed), seed, 80, 30, GraphModel::SPAN);
+        TestUpdateDb("update, route model, seed "s + std::to_string(seed), seed, 80, 30, GraphModel::ROUTE);
+    }
+    TestUpdateDb("update, span model, sparse city"s, 4, 150, 12, GraphModel::SPAN);
+    TestUpdateDb("update, route model, sparse city"s, 4, 150, 12, GraphModel::ROUTE);
+    return tests::Finish("transport_router_test"s);
+}
@@ -4,6 +4,7 @@
 namespace transport_catalogue {
 
     void TransportCatalogue::AddStop(const InputStopInfo *stop, std::optional<size_t> id = std::nullopt) {
+        Unfreeze();
         using namespace std::string_literals;
         if (stop == nullptr) {
             throw std::runtime_error("Try to add stop with nullptr"s);
@@ -16,10 +17,12 @@ namespace transport_catalogue {
     }
 
     const Stop *TransportCatalogue::FindStop(std::string_view stop_name) const {
-        if (stop_name_to_stop_.count(stop_name)) {
-            return const_cast<Stop *>(stop_name_to_stop_.at(stop_name));
+        if (is_frozen_) {
+            const auto stop_id = stop_name_index_.Find(stop_name, [this](uint32_t id) { return GetStopName(id); });
+            return stop_id ? &stops_[*stop_id] : nullptr;
         }
-        return nullptr;
+        const auto stop_it = stop_name_to_stop_.find(stop_name);
+        return stop_it != stop_name_to_stop_.end() ? stop_it->second : nullptr;
     }
 
     const Stop *TransportCatalogue::FindStopById(size_t id) const {
@@ -38,11 +41,40 @@ namespace transport_catalogue {
     }
 
     void TransportCatalogue::AddBus(const InputBusInfo *bus, std::optional<size_t> id = std::nullopt) {
+        Unfreeze();
         using namespace std::string_literals;
 
         if (bus == nullptr) {
             throw std::runtime_error("Try to add bus with nullptr"s);
         }
+        std::vector<Stop *> stops = CollectBusStops(bus);
+
+        size_t new_id = id ? *id : last_bus_id_++;
+
+        auto &new_bus = EmplaceBus(bus->bus_name, std::move(stops), bus->is_circled, new_id);
+        new_bus.departures = bus->departures;
+        bus_name_to_bus_[new_bus.bus_name] = &new_bus;
+    }
+
+    Bus &TransportCatalogue::EmplaceBus(std::string bus_name, std::vector<Stop *> stops, bool is_circled, size_t id) {
+        auto &new_bus = buses_.emplace_back(Bus{std::move(bus_name), std::move(stops), 0, 0, is_circled, id});
+        new_bus.stops_num = static_cast<int>(new_bus.stops.size());
+        new_bus.uniq_stops_num = static_cast<int>(CountUniqStops(&new_bus));
+        return new_bus;
+    }
+
+    void TransportCatalogue::MirrorBusStops(std::vector<Stop *> &stops, bool is_circled) {
+        if (!is_circled) {
+            // Без запаса ёмкости вставка в конец сделала бы недействительными итераторы источника
+            stops.reserve(stops.size() * 2 - 1);
+            std::copy(next(stops.rbegin()), stops.rend(), std::back_inserter(stops));
+        }
+    }
+
+
+    std::vector<Stop *> TransportCatalogue::CollectBusStops(const InputBusInfo *bus) const {
+        using namespace std::string_literals;
+
         std::vector<Stop *> stops;
         auto stops_num = bus->is_circled ? bus->stops.size() : (bus->stops.size() - 1) * 2;
         stops.reserve(stops_num);
@@ -55,32 +87,97 @@ namespace transport_catalogue {
             }
         }
 
-        if (!bus->is_circled) {
-            std::copy(next(stops.rbegin()), stops.rend(), std::back_inserter(stops));
-        }
+        MirrorBusStops(stops, bus->is_circled);
 
         if (*stops.begin() != *stops.rbegin()) {
             throw std::runtime_error("Bus "s + bus->bus_name + " is not closed"s);
         }
+        return stops;
+    }
 
-        size_t new_id = id ? *id : last_bus_id_++;
+    void TransportCatalogue::UpdateStop(const InputStopInfo *stop) {
+        Unfreeze();
+        using namespace std::string_literals;
+        if (stop == nullptr) {
+            throw std::runtime_error("Try to update stop with nullptr"s);
+        }
 
-        auto &new_bus = buses_.emplace_back(std::move(Bus{bus->bus_name, std::move(stops), 0, 0, bus->is_circled, new_id}));
-        new_bus.stops_num = static_cast<int>(new_bus.stops.size());
-        new_bus.uniq_stops_num = static_cast<int>(CountUniqStops(&new_bus));
-        bus_name_to_bus_[new_bus.bus_name] = &new_bus;
+        if (const auto stop_it = stop_name_to_stop_.find(stop->stop_name); stop_it != stop_name_to_stop_.end()) {
+            stop_it->second->coordinates = stop->coordinates;
+        } else {
+            AddStop(stop, std::nullopt);
+        }
+    }
+
+    void TransportCatalogue::UpdateBus(const InputBusInfo *bus) {
+        Unfreeze();
+        using namespace std::string_literals;
+        if (bus == nullptr) {
+            throw std::runtime_error("Try to update bus with nullptr"s);
+        }
 
-        for (auto stop: new_bus.stops) {
-            stop_to_buses_[stop].insert(&new_bus);
+        const auto bus_it = bus_name_to_bus_.find(bus->bus_name);
+        if (bus_it == bus_name_to_bus_.end()) {
+            AddBus(bus, std::nullopt);
+            return;
+        }
+
+        Bus &old_bus = *bus_it->second;
+        old_bus.stops = CollectBusStops(bus);
+        old_bus.is_circled = bus->is_circled;
+        old_bus.stops_num = static_cast<int>(old_bus.stops.size());
+        old_bus.uniq_stops_num = static_cast<int>(CountUniqStops(&old_bus));
+        old_bus.departures = bus->departures;
+        ReindexBuses();
+    }
+
+    void TransportCatalogue::RemoveBus(std::string_view bus_name) {
+        Unfreeze();
+        using namespace std::string_literals;
+
+        const auto bus_it = std::find_if(buses_.begin(), buses_.end(), [bus_name](const Bus &bus) {
+            return bus.bus_name == bus_name;
+        });
+        if (bus_it == buses_.end()) {
+            throw std::runtime_error("No bus "s + std::string(bus_name) + " in DB to remove"s);
+        }
+        buses_.erase(bus_it);
+        ReindexBuses();
+    }
+
+    // Изменение загруженной базы: хеш-таблицы названий, которые при загрузке не строятся,
+    // восстанавливаются по stops_ и buses_
+    void TransportCatalogue::Unfreeze() {
+        if (!is_frozen_) {
+            return;
+        }
+        stop_name_to_stop_.clear();
+        for (auto &stop: stops_) {
+            stop_name_to_stop_[stop.stop_name] = &stop;
         }
+        ReindexBuses();
+        is_frozen_ = false;
     }
 
+    // Удаление из середины deque делает указатели на маршруты недействительными,
+    // поэтому индексы по маршрутам строятся заново, а номера идут подряд
+    void TransportCatalogue::ReindexBuses() {
+        bus_name_to_bus_.clear();
+        last_bus_id_ = 0;
+
+        for (auto &bus: buses_) {
+            bus.id = last_bus_id_++;
+            bus_name_to_bus_[bus.bus_name] = &bus;
+        }
+    }
 
     const Bus *TransportCatalogue::FindBus(std::string_view bus_name) const {
-        if (bus_name_to_bus_.count(bus_name)) {
-            return const_cast<Bus *>(bus_name_to_bus_.at(bus_name));
+        if (is_frozen_) {
+            const auto bus_id = bus_name_index_.Find(bus_name, [this](uint32_t id) { return GetBusName(id); });
+            return bus_id ? &buses_[*bus_id] : nullptr;
         }
-        return nullptr;
+        const auto bus_it = bus_name_to_bus_.find(bus_name);
+        return bus_it != bus_name_to_bus_.end() ? bus_it->second : nullptr;
     }
 
     const Bus *TransportCatalogue::FindBusById(size_t id) const {
@@ -108,49 +205,117 @@ namespace transport_catalogue {
     }
 
 
-    std::optional<BusInfoResponse> TransportCatalogue::GetBusInfo(std::string_view bus_name) const {
-        BusInfoResponse res;
-        res.bus_name = bus_name;
+    void TransportCatalogue::ComputeBusStats(Bus &bus) const {
+        bus.route_length = 0;
+        bus.real_length = 0;
+        for (auto begin_it = bus.stops.begin(); begin_it != bus.stops.end(); ++begin_it) {
+            if (next(begin_it) == bus.stops.end()) {
+                break;
+            }
+            bus.route_length += GetStopDistance(*begin_it, *next(begin_it));
+            bus.real_length += GetStopRealDistance(*begin_it, *next(begin_it));
+        }
 
+        bus.curvature = 1.0 * bus.real_length / bus.route_length;
+    }
 
-        if (bus_name_to_bus_.find(bus_name) == bus_name_to_bus_.end()) {
-            return {};
+    void TransportCatalogue::BuildFrozenArrays() {
+        name_pool_.clear();
+        stop_name_offsets_.assign(1, 0);
+        stop_coordinates_.clear();
+        bus_stop_offsets_.assign(1, 0);
+        bus_stop_ids_.clear();
+
+        // Номер остановки и автобуса совпадает с позицией в stops_ и buses_
+        for (const auto &stop: stops_) {
+            name_pool_ += stop.stop_name;
+            stop_name_offsets_.push_back(static_cast<uint32_t>(name_pool_.size()));
+            stop_coordinates_.push_back(stop.coordinates);
+        }
+        bus_name_offsets_.assign(1, static_cast<uint32_t>(name_pool_.size()));
+        for (const auto &bus: buses_) {
+            name_pool_ += bus.bus_name;
+            bus_name_offsets_.push_back(static_cast<uint32_t>(name_pool_.size()));
+            for (const Stop *stop: bus.stops) {
+                bus_stop_ids_.push_back(static_cast<uint32_t>(stop->id));
+            }
+            bus_stop_offsets_.push_back(static_cast<uint32_t>(bus_stop_ids_.size()));
         }
-        auto bus = bus_name_to_bus_.at(bus_name);
+    }
 
-        for (auto begin_it = bus->stops.begin(); begin_it != bus->stops.end(); ++begin_it) {
-            if (next(begin_it) == bus->stops.end()) {
-                break;
+    void TransportCatalogue::BuildNameIndices() {
+        stop_name_index_.Build(stops_.size(), [this](uint32_t id) { return GetStopName(id); });
+        bus_name_index_.Build(buses_.size(), [this](uint32_t id) { return GetBusName(id); });
+    }
+
+    void TransportCatalogue::BuildStopBusesIndex() {
+        constexpr uint32_t NO_BUS = std::numeric_limits<uint32_t>::max();
+
+        // Автобус учитывается у остановки один раз, сколько бы раз он её ни проходил
+        std::vector<uint32_t> last_bus_ids(stops_.size(), NO_BUS);
+        stop_bus_offsets_.assign(stops_.size() + 1, 0);
+        for (uint32_t bus_id = 0; bus_id < buses_.size(); ++bus_id) {
+            for (const auto stop_id: GetBusStopIds(bus_id)) {
+                if (last_bus_ids[stop_id] != bus_id) {
+                    last_bus_ids[stop_id] = bus_id;
+                    ++stop_bus_offsets_[stop_id + 1];
+                }
             }
-            res.route_length += GetStopDistance(*begin_it, *next(begin_it));
-            res.real_length += GetStopRealDistance(*begin_it, *next(begin_it));
+        }
+        for (size_t stop_id = 0; stop_id < stops_.size(); ++stop_id) {
+            stop_bus_offsets_[stop_id + 1] += stop_bus_offsets_[stop_id];
         }
 
-        res.curvature = 1.0 * res.real_length / res.route_length;
+        stop_bus_ids_.resize(stop_bus_offsets_.back());
+        std::vector<uint32_t> positions(stop_bus_offsets_.begin(), std::prev(stop_bus_offsets_.end()));
+        last_bus_ids.assign(stops_.size(), NO_BUS);
+        for (uint32_t bus_id = 0; bus_id < buses_.size(); ++bus_id) {
+            for (const auto stop_id: GetBusStopIds(bus_id)) {
+                if (last_bus_ids[stop_id] != bus_id) {
+                    last_bus_ids[stop_id] = bus_id;
+                    stop_bus_ids_[positions[stop_id]++] = bus_id;
+                }
+            }
+        }
 
-        res.stops_num = bus->stops_num;
-        res.uniq_stops_num = bus->uniq_stops_num;
-        return res;
+        for (size_t stop_id = 0; stop_id < stops_.size(); ++stop_id) {
+            std::sort(std::next(stop_bus_ids_.begin(), stop_bus_offsets_[stop_id]),
+                      std::next(stop_bus_ids_.begin(), stop_bus_offsets_[stop_id + 1]),
+                      [this](uint32_t lhs, uint32_t rhs) {
+                          return GetBusName(lhs) < GetBusName(rhs);
+                      });
+        }
     }
 
-    std::optional<StopInfoResponse> TransportCatalogue::GetStopInfo(std::string_view stop_name) const {
-        auto stop_it = stop_name_to_stop_.find(stop_name);
-        if (stop_it == stop_name_to_stop_.end()) {
-            return {};
+    void TransportCatalogue::Freeze() {
+        for (auto &bus: buses_) {
+            ComputeBusStats(bus);
         }
+        BuildFrozenArrays();
+        BuildNameIndices();
+        BuildStopBusesIndex();
+        is_frozen_ = true;
+    }
 
-        if (stop_to_buses_.find(stop_it->second) == stop_to_buses_.end()) {
-            return StopInfoResponse{stop_name, {}};
+    std::optional<BusInfoResponse> TransportCatalogue::GetBusInfo(std::string_view bus_name) const {
+        const Bus *bus_p = FindBus(bus_name);
+        if (!bus_p) {
+            return {};
         }
+        const Bus &bus = *bus_p;
+        return BusInfoResponse{bus_name, bus.stops_num, bus.uniq_stops_num, bus.route_length, bus.real_length,
+                               bus.curvature};
+    }
 
-        auto buses = stop_to_buses_.at(stop_it->second);
-
-        std::vector<Bus *> bus_p_vec{buses.begin(), buses.end()};
-        std::sort(bus_p_vec.begin(), bus_p_vec.end(), [](auto lhs, auto rhs) {
-            return lhs->bus_name < rhs->bus_name;
-        });
+    std::optional<StopInfoResponse> TransportCatalogue::GetStopInfo(std::string_view stop_name) const {
+        const Stop *stop = FindStop(stop_name);
+        if (!stop) {
+            return {};
+        }
 
-        return StopInfoResponse{stop_name, bus_p_vec};
+        const size_t stop_id = stop->id;
+        return StopInfoResponse{stop_name, {std::next(stop_bus_ids_.begin(), stop_bus_offsets_[stop_id]),
+                                            std::next(stop_bus_ids_.begin(), stop_bus_offsets_[stop_id + 1])}};
     }
 
     void TransportCatalogue::AddRealDistance(const InputDistanceInfo *distance_info) {
@@ -190,9 +355,8 @@ namespace transport_catalogue {
         res.reserve(stops_.size());
 
         for (auto &stop: stops_) {
-            if (stop_to_buses_.find(&stop) != stop_to_buses_.end()) {
+            if (stop_bus_offsets_[stop.id] != stop_bus_offsets_[stop.id + 1]) {
                 res.emplace_back(&stop);
-
             }
         }
 
@@ -231,8 +395,18 @@ namespace transport_catalogue {
         buses_.clear();
         stop_name_to_stop_.clear();
         bus_name_to_bus_.clear();
-        stop_to_buses_.clear();
         neighbour_distance_.clear();
+        stop_bus_offsets_.clear();
+        stop_bus_ids_.clear();
+        name_pool_.clear();
+        stop_name_offsets_.clear();
+        bus_name_offsets_.clear();
+        stop_coordinates_.clear();
+        bus_stop_offsets_.clear();
+        bus_stop_ids_.clear();
+        stop_name_index_.Clear();
+        bus_name_index_.Clear();
+        is_frozen_ = false;
         last_stop_id_ = 0;
         last_bus_id_ = 0;
     }
@@ -254,9 +428,9 @@ namespace transport_catalogue {
 
     void TransportCatalogue::DeserializeStops(const transport_catalogue_protobuf::AllStops &proto_all_stops) {
         for (const auto &proto_stop: proto_all_stops.stops()) {
-            const InputStopInfo stop_info{proto_stop.name(),
-                                          geo::Coordinates{proto_stop.latitude(), proto_stop.longitude()}};
-            AddStop(&stop_info, proto_stop.id());
+            stops_.emplace_back(Stop{proto_stop.name(),
+                                     geo::Coordinates{proto_stop.latitude(), proto_stop.longitude()},
+                                     proto_stop.id()});
         }
         last_stop_id_ = stops_.size();
     }
@@ -282,6 +456,10 @@ namespace transport_catalogue {
                 //proto_bus.add_stops((*stop_it)->id);
                 proto_bus.add_stops(stop->id);
             }
+            proto_bus.mutable_departures()->Add(bus.departures.begin(), bus.departures.end());
+            proto_bus.set_route_length(bus.route_length);
+            proto_bus.set_real_length(bus.real_length);
+            proto_bus.set_curvature(bus.curvature);
             *proto_all_buses.add_buses() = std::move(proto_bus);
         }
         return proto_all_buses;
@@ -290,16 +468,19 @@ namespace transport_catalogue {
     void TransportCatalogue::DeserializeBuses(const transport_catalogue_protobuf::AllBuses &proto_all_buses) {
 
         for (const auto &proto_bus: proto_all_buses.buses()) {
-            InputBusInfo bus_info;
-
-            bus_info.bus_name = proto_bus.name();
-            bus_info.is_circled = proto_bus.is_circled();
-
+            std::vector<Stop *> stops;
             for (const auto &proto_stop_id: proto_bus.stops()) {
-                bus_info.stops.emplace_back(FindStopById(proto_stop_id)->stop_name);
+                stops.push_back(const_cast<Stop *>(FindStopById(proto_stop_id)));
             }
-            AddBus(&bus_info, proto_bus.id());
+            MirrorBusStops(stops, proto_bus.is_circled());
+
+            Bus &bus = EmplaceBus(proto_bus.name(), std::move(stops), proto_bus.is_circled(), proto_bus.id());
+            bus.departures.assign(proto_bus.departures().begin(), proto_bus.departures().end());
+            bus.route_length = proto_bus.route_length();
+            bus.real_length = proto_bus.real_length();
+            bus.curvature = proto_bus.curvature();
         }
+        last_bus_id_ = buses_.size();
     }
 
     transport_catalogue_protobuf::TransportCatalogueData TransportCatalogue::Serialize() const {
@@ -307,6 +488,8 @@ namespace transport_catalogue {
         *proto_transport_catalogue_data.mutable_stops() = std::move(SerializeStops());
         *proto_transport_catalogue_data.mutable_buses() = std::move(SerializeBuses());
         *proto_transport_catalogue_data.mutable_distances() = std::move(SerializeDistance());
+        *proto_transport_catalogue_data.mutable_stop_name_index() = stop_name_index_.Serialize();
+        *proto_transport_catalogue_data.mutable_bus_name_index() = bus_name_index_.Serialize();
         return proto_transport_catalogue_data;
     }
 
@@ -316,6 +499,23 @@ namespace transport_catalogue {
         DeserializeStops(proto_transport_catalogue_data.stops());
         DeserializeBuses(proto_transport_catalogue_data.buses());
         DeserializeDistance(proto_transport_catalogue_data.distances());
+        // В базах, собранных до сохранения статистики маршрутов, её поля нулевые: она считается при загрузке.
+        // Длина по прямой нулевая и у маршрута из одной точки, его пересчёт даёт те же значения
+        for (auto &bus: buses_) {
+            if (bus.route_length == 0) {
+                ComputeBusStats(bus);
+            }
+        }
+        BuildFrozenArrays();
+        // Хеш-таблицы названий не строятся: функции названий готовы в базе. Базы без них
+        // (собранные прежней версией) получают функции при загрузке
+        stop_name_index_.Deserialize(proto_transport_catalogue_data.stop_name_index());
+        bus_name_index_.Deserialize(proto_transport_catalogue_data.bus_name_index());
+        if (stop_name_index_.GetNameCount() != stops_.size() || bus_name_index_.GetNameCount() != buses_.size()) {
+            BuildNameIndices();
+        }
+        BuildStopBusesIndex();
+        is_frozen_ = true;
     }
 
     transport_catalogue_protobuf::AllDistances TransportCatalogue::SerializeDistance() const {
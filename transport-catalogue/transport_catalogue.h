@@ -9,9 +9,13 @@
 #include <stdexcept>
 #include <set>
 #include <optional>
+#include <iterator>
+#include <limits>
+#include <vector>
 
 #include <transport_catalogue.pb.h>
 #include "domain.h"
+#include "name_index.h"
 #include "transport_catalogue.pb.h"
 
 namespace transport_catalogue {
@@ -31,6 +35,39 @@ namespace transport_catalogue {
 
         const Bus *FindBusById(size_t id) const;
 
+        // Изменение готовой базы: у существующей остановки меняются координаты, новая добавляется
+        void UpdateStop(const InputStopInfo *stop);
+
+        // Маршрут с существующим именем заменяется с сохранением номера, новый добавляется
+        void UpdateBus(const InputBusInfo *bus);
+
+        // Номера маршрутов после удалённого сдвигаются
+        void RemoveBus(std::string_view bus_name);
+
+        // Длины и извилистость всех маршрутов и индекс автобусов по остановкам строятся один раз,
+        // после загрузки или изменения справочника; до вызова GetBusInfo и GetStopInfo их не видят
+        void Freeze();
+
+        // Замороженное представление по номерам: названия из общего пула строк, координаты и остановки
+        // автобусов из плоских массивов. Действительно после Freeze или Deserialize
+        std::string_view GetStopName(size_t stop_id) const {
+            return GetPooledName(stop_name_offsets_, stop_id);
+        }
+
+        std::string_view GetBusName(size_t bus_id) const {
+            return GetPooledName(bus_name_offsets_, bus_id);
+        }
+
+        const geo::Coordinates &GetStopCoordinates(size_t stop_id) const {
+            return stop_coordinates_[stop_id];
+        }
+
+        // Остановки автобуса в порядке следования, у некольцевого — туда и обратно, как в Bus::stops
+        IdRange GetBusStopIds(size_t bus_id) const {
+            return {std::next(bus_stop_ids_.begin(), bus_stop_offsets_[bus_id]),
+                    std::next(bus_stop_ids_.begin(), bus_stop_offsets_[bus_id + 1])};
+        }
+
         std::optional<BusInfoResponse> GetBusInfo(std::string_view bus_name) const;
 
         std::optional<StopInfoResponse> GetStopInfo(std::string_view stop_name) const;
@@ -76,11 +113,49 @@ namespace transport_catalogue {
         std::deque<Bus> buses_;
         std::unordered_map<std::string_view, Stop *> stop_name_to_stop_;
         std::unordered_map<std::string_view, Bus *> bus_name_to_bus_;
-        std::unordered_map<Stop *, std::set<Bus * >> stop_to_buses_;
         std::unordered_map<std::pair<const Stop *, const Stop *>, int, detail::PairOfStopPointersHash> neighbour_distance_;
+        std::vector<uint32_t> stop_bus_offsets_;
+        std::vector<uint32_t> stop_bus_ids_;
+
+        std::string name_pool_;
+        std::vector<uint32_t> stop_name_offsets_;
+        std::vector<uint32_t> bus_name_offsets_;
+        std::vector<geo::Coordinates> stop_coordinates_;
+        std::vector<uint32_t> bus_stop_offsets_;
+        std::vector<uint32_t> bus_stop_ids_;
+        // После Freeze названия ищутся совершенными хеш-функциями над пулом строк, до него — по хеш-таблицам
+        // выше; в загруженной базе хеш-таблицы пусты до первого изменения
+        NameIndex stop_name_index_;
+        NameIndex bus_name_index_;
+        bool is_frozen_ = false;
 
         size_t CountUniqStops(Bus *bus);
 
+        void ComputeBusStats(Bus &bus) const;
+
+        void BuildFrozenArrays();
+
+        void BuildNameIndices();
+
+        void Unfreeze();
+
+        Bus &EmplaceBus(std::string bus_name, std::vector<Stop *> stops, bool is_circled, size_t id);
+
+        // У некольцевого маршрута к остановкам туда добавляются остановки обратно
+        static void MirrorBusStops(std::vector<Stop *> &stops, bool is_circled);
+
+        std::string_view GetPooledName(const std::vector<uint32_t> &offsets, size_t id) const {
+            return std::string_view(name_pool_).substr(offsets[id], offsets[id + 1] - offsets[id]);
+        }
+
+        // Автобусы остановки с номером id — stop_bus_ids_[stop_bus_offsets_[id] .. stop_bus_offsets_[id + 1]),
+        // отсортированные по названию
+        void BuildStopBusesIndex();
+
+        std::vector<Stop *> CollectBusStops(const InputBusInfo *bus) const;
+
+        void ReindexBuses();
+
         size_t last_stop_id_ = 0;
         size_t last_bus_id_ = 0;
     };
@@ -1,8 +1,110 @@
 #include "transport_router.h"
 #include "transport_router.pb.h"
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
 namespace transport_catalogue {
 
+    namespace {
+
+        constexpr double WEIGHT_UNITS_PER_MINUTE = std::is_integral_v<RouteWeight> ? 600.0 : 1.0;
+
+        // С целыми весами время в пути округляется вверх: вес ребра не меньше настоящего времени,
+        // и оценка A* по расстоянию остаётся допустимой
+        RouteWeight ToRouteWeight(double minutes) {
+            if constexpr (std::is_integral_v<RouteWeight>) {
+                return static_cast<RouteWeight>(std::ceil(minutes * WEIGHT_UNITS_PER_MINUTE - 1e-9));
+            } else {
+                return minutes;
+            }
+        }
+
+        // Наибольший вес, укладывающийся в бюджет времени
+        RouteWeight ToRouteWeightBudget(double minutes) {
+            if constexpr (std::is_integral_v<RouteWeight>) {
+                const double units = std::floor(minutes * WEIGHT_UNITS_PER_MINUTE + 1e-9);
+                return static_cast<RouteWeight>(
+                        std::clamp(units, 0.0, static_cast<double>(std::numeric_limits<RouteWeight>::max())));
+            } else {
+                return minutes;
+            }
+        }
+
+        double ToMinutes(RouteWeight weight) {
+            return weight / WEIGHT_UNITS_PER_MINUTE;
+        }
+
+        // Участки автобуса по позициям остановок: у кольцевого — весь маршрут, у линейного — туда и обратно
+        template<class Func>
+        void ForEachBusRange(const Bus &bus, Func func) {
+            if (bus.is_circled) {
+                func(0, bus.stops.size());
+            } else {
+                func(0, bus.stops.size() / 2 + 1);
+                func(bus.stops.size() / 2, bus.stops.size());
+            }
+        }
+
+    }
+
+    RouterEngine ParseRouterEngine(std::string_view name) {
+        using namespace std::literals;
+        if (name == "all_pairs"sv) {
+            return RouterEngine::ALL_PAIRS;
+        }
+        if (name == "dijkstra"sv) {
+            return RouterEngine::DIJKSTRA;
+        }
+        if (name == "contraction_hierarchy"sv) {
+            return RouterEngine::CONTRACTION_HIERARCHY;
+        }
+        if (name == "raptor"sv) {
+            return RouterEngine::RAPTOR;
+        }
+        if (name == "a_star"sv) {
+            return RouterEngine::A_STAR;
+        }
+        if (name == "hub_labels"sv) {
+            return RouterEngine::HUB_LABELS;
+        }
+        if (name == "lazy_all_pairs"sv) {
+            return RouterEngine::LAZY_ALL_PAIRS;
+        }
+        throw std::domain_error("Unknown router engine "s + std::string(name));
+    }
+
+    GraphModel ParseGraphModel(std::string_view name) {
+        using namespace std::literals;
+        if (name == "span"sv) {
+            return GraphModel::SPAN;
+        }
+        if (name == "route"sv) {
+            return GraphModel::ROUTE;
+        }
+        throw std::domain_error("Unknown graph model "s + std::string(name));
+    }
+
+    RouteTableFormat ParseRouteTableFormat(std::string_view name) {
+        using namespace std::literals;
+        if (name == "nested"sv) {
+            return RouteTableFormat::NESTED;
+        }
+        if (name == "packed"sv) {
+            return RouteTableFormat::PACKED;
+        }
+        if (name == "rebuild"sv) {
+            return RouteTableFormat::REBUILD;
+        }
+        throw std::domain_error("Unknown route table format "s + std::string(name));
+    }
+
     void TransportRouter::SetDb(const TransportCatalogue &db) {
         db_ = db;
     }
@@ -21,58 +123,403 @@ namespace transport_catalogue {
         bus_velocity_ = velocity * 1'000.0 / 60.0;
     }
 
-    void TransportRouter::FillGraph() {
+    void TransportRouter::SetRouterEngine(RouterEngine engine) {
+        engine_ = engine;
+    }
+
+    void TransportRouter::SetBuildThreads(int threads) {
+        if (threads < 0 || threads > 1024) {
+            throw std::domain_error("Build threads count is out of range 0 : 1024");
+        }
+        build_threads_ = static_cast<size_t>(threads);
+    }
 
-        graph_ = Graph(db_.GetLastStopId() * 2);
-        edges_data_.reserve(db_.GetLastStopId() * 10);
+    void TransportRouter::SetGraphBuildThreads(int threads) {
+        if (threads < 0 || threads > 1024) {
+            throw std::domain_error("Graph build threads count is out of range 0 : 1024");
+        }
+        graph_build_threads_ = static_cast<size_t>(threads);
+    }
 
+    void TransportRouter::SetGraphModel(GraphModel model) {
+        graph_model_ = model;
+    }
+
+    void TransportRouter::SetRouteCacheBytes(double bytes) {
+        if (bytes < 0) {
+            throw std::domain_error("Route cache size should be non-negative");
+        }
+        route_cache_bytes_ = static_cast<size_t>(bytes);
+    }
+
+    void TransportRouter::SetRouteTableFormat(RouteTableFormat format) {
+        route_table_format_ = format;
+    }
+
+    void TransportRouter::IndexServedStops() {
+        std::vector<bool> is_served(db_.GetLastStopId(), false);
         for (const auto &bus: db_.GetAllBuses()) {
+            for (const auto stop_id: db_.GetBusStopIds(bus->id)) {
+                is_served[stop_id] = true;
+            }
+        }
 
-            const auto dist_vec = db_.GetBusRealDistances(bus);
+        stop_indices_.assign(db_.GetLastStopId(), NO_STOP_INDEX);
+        served_stop_ids_.clear();
+        for (size_t stop_id = 0; stop_id < is_served.size(); ++stop_id) {
+            if (is_served[stop_id]) {
+                stop_indices_[stop_id] = static_cast<uint32_t>(served_stop_ids_.size());
+                served_stop_ids_.push_back(stop_id);
+            }
+        }
+    }
 
-            if (bus->is_circled) {
-                FillGraphByStopRange(bus->stops.begin(), bus->stops.end(), dist_vec.begin(), bus->id, bus->bus_name);
-            } else {
-                const auto second_end_stop = std::next(bus->stops.begin(), bus->stops.size() / 2);
-                FillGraphByStopRange(bus->stops.begin(), std::next(second_end_stop), dist_vec.begin(), bus->id,
-                                     bus->bus_name);
-                FillGraphByStopRange(second_end_stop, bus->stops.end(),
-                                     std::next(dist_vec.begin(), bus->stops.size() / 2), bus->id, bus->bus_name);
+    graph::VertexId TransportRouter::GetStopVertex(size_t stop_id) const {
+        const graph::VertexId stop_index = stop_indices_[stop_id];
+        return graph_model_ == GraphModel::SPAN ? stop_index * 2 : stop_index;
+    }
+
+    std::vector<TransportRouter::VertexKey> TransportRouter::CollectVertexKeys() const {
+        std::vector<VertexKey> keys;
+        keys.reserve(graph_.GetVertexCount());
+        for (const size_t stop_id: served_stop_ids_) {
+            const std::string stop_name(db_.GetStopName(stop_id));
+            keys.emplace_back(false, stop_name, 0);
+            if (graph_model_ == GraphModel::SPAN) {
+                keys.emplace_back(false, stop_name, 1);
+            }
+        }
+        if (graph_model_ == GraphModel::ROUTE) {
+            // Вершины маршрутов идут за вершинами остановок по автобусам, как их выдаёт BuildGraph
+            for (const auto &bus: db_.GetAllBuses()) {
+                size_t route_vertex_count = 0;
+                ForEachBusRange(*bus, [&route_vertex_count](size_t begin, size_t end) {
+                    route_vertex_count += end - begin;
+                });
+                const std::string bus_name(db_.GetBusName(bus->id));
+                for (size_t position = 0; position < route_vertex_count; ++position) {
+                    keys.emplace_back(true, bus_name, position);
+                }
+            }
+        }
+        return keys;
+    }
+
+    std::optional<size_t> TransportRouter::GetVertexStop(graph::VertexId vertex) const {
+        if (graph_model_ == GraphModel::SPAN) {
+            if (vertex % 2 == 0) {
+                return served_stop_ids_[vertex / 2];
             }
+        } else if (vertex < served_stop_ids_.size()) {
+            return served_stop_ids_[vertex];
+        }
+        return std::nullopt;
+    }
+
+    void TransportRouter::FillGraph() {
+        ComputeStopComponents();
+        IndexServedStops();
+        InitializeTimetableRouter();
+        if (engine_ != RouterEngine::RAPTOR) {
+            BuildGraph();
         }
         InitializeRouter();
     }
 
+    void TransportRouter::UpdateDb(const TransportCatalogue &db) {
+        if (engine_ != RouterEngine::ALL_PAIRS || !router_) {
+            SetDb(db);
+            FillGraph();
+            return;
+        }
+
+        // Ребро узнаётся по концам в номерах нового графа, типу, числу пролётов и имени автобуса или остановки
+        using EdgeKey = std::tuple<graph::VertexId, graph::VertexId, EdgeType, int, std::string>;
+        struct OldEdge {
+            graph::VertexId from;
+            graph::VertexId to;
+            EdgeType type;
+            int span;
+            std::string name;
+            RouteWeight weight;
+        };
+
+        // Имена в edges_data_ ссылаются на прежний справочник, поэтому ключи собираются до его замены
+        const auto old_vertex_keys = CollectVertexKeys();
+        std::vector<OldEdge> old_edges;
+        old_edges.reserve(graph_.GetEdgeCount());
+        for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const auto &edge = graph_.GetEdge(edge_id);
+            const auto &edge_data = edges_data_[edge_id];
+            old_edges.push_back({edge.from, edge.to, edge_data.type, edge_data.span, std::string(edge_data.name),
+                                 edge.weight});
+        }
+
+        SetDb(db);
+        ComputeStopComponents();
+        IndexServedStops();
+        InitializeTimetableRouter();
+        BuildGraph();
+
+        // Вершины с одинаковым ключом (остановки-тёзки) не сопоставляются: их метки считаются заново
+        std::map<VertexKey, graph::VertexId> new_vertices;
+        const auto new_vertex_keys = CollectVertexKeys();
+        for (graph::VertexId vertex = 0; vertex < new_vertex_keys.size(); ++vertex) {
+            const auto [it, is_inserted] = new_vertices.emplace(new_vertex_keys[vertex], vertex);
+            if (!is_inserted) {
+                it->second = graph::NO_VERTEX;
+            }
+        }
+        std::map<VertexKey, size_t> old_key_counts;
+        for (const auto &key: old_vertex_keys) {
+            ++old_key_counts[key];
+        }
+        std::vector<graph::VertexId> vertex_mapping(old_vertex_keys.size(), graph::NO_VERTEX);
+        for (graph::VertexId vertex = 0; vertex < old_vertex_keys.size(); ++vertex) {
+            const auto it = new_vertices.find(old_vertex_keys[vertex]);
+            if (it != new_vertices.end() && old_key_counts[old_vertex_keys[vertex]] == 1) {
+                vertex_mapping[vertex] = it->second;
+            }
+        }
+
+        std::map<EdgeKey, std::vector<graph::EdgeId>> new_edges;
+        for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const auto &edge = graph_.GetEdge(edge_id);
+            const auto &edge_data = edges_data_[edge_id];
+            new_edges[EdgeKey{edge.from, edge.to, edge_data.type, edge_data.span, std::string(edge_data.name)}]
+                    .push_back(edge_id);
+        }
+
+        // Ребро сопоставляется, только если сохранились оба его конца и вес
+        std::vector<graph::EdgeId> edge_mapping(old_edges.size(), graph::NO_EDGE);
+        for (graph::EdgeId edge_id = 0; edge_id < old_edges.size(); ++edge_id) {
+            const auto &old_edge = old_edges[edge_id];
+            const graph::VertexId from = vertex_mapping[old_edge.from];
+            const graph::VertexId to = vertex_mapping[old_edge.to];
+            if (from == graph::NO_VERTEX || to == graph::NO_VERTEX) {
+                continue;
+            }
+            const auto new_edges_it = new_edges.find(EdgeKey{from, to, old_edge.type, old_edge.span, old_edge.name});
+            if (new_edges_it == new_edges.end()) {
+                continue;
+            }
+            auto &candidates = new_edges_it->second;
+            const auto match = std::find_if(candidates.begin(), candidates.end(), [&](graph::EdgeId new_edge_id) {
+                return graph_.GetEdge(new_edge_id).weight == old_edge.weight;
+            });
+            if (match != candidates.end()) {
+                edge_mapping[edge_id] = *match;
+                candidates.erase(match);
+            }
+        }
+
+        static_cast<graph::Router<RouteWeight> &>(*router_).Update(vertex_mapping, edge_mapping);
+    }
+
+    void TransportRouter::ComputeStopComponents() {
+        std::vector<size_t> parents(db_.GetLastStopId());
+        std::iota(parents.begin(), parents.end(), 0);
+        auto find_root = [&parents](size_t stop_id) {
+            while (parents[stop_id] != stop_id) {
+                parents[stop_id] = parents[parents[stop_id]];
+                stop_id = parents[stop_id];
+            }
+            return stop_id;
+        };
+
+        std::vector<bool> has_buses(db_.GetLastStopId(), false);
+        for (const auto &bus: db_.GetAllBuses()) {
+            const auto stop_ids = db_.GetBusStopIds(bus->id);
+            const size_t root = find_root(*stop_ids.begin());
+            for (const auto stop_id: stop_ids) {
+                has_buses[stop_id] = true;
+                parents[find_root(stop_id)] = root;
+            }
+        }
+
+        stop_components_.assign(db_.GetLastStopId(), NO_COMPONENT);
+        std::vector<uint32_t> root_components(db_.GetLastStopId(), NO_COMPONENT);
+        uint32_t component_count = 0;
+        for (size_t stop_id = 0; stop_id < stop_components_.size(); ++stop_id) {
+            if (!has_buses[stop_id]) {
+                continue;
+            }
+            auto &component = root_components[find_root(stop_id)];
+            if (component == NO_COMPONENT) {
+                component = component_count++;
+            }
+            stop_components_[stop_id] = component;
+        }
+    }
+
+    bool TransportRouter::AreConnected(size_t stop_from_id, size_t stop_to_id) const {
+        return stop_components_[stop_from_id] != NO_COMPONENT &&
+               stop_components_[stop_from_id] == stop_components_[stop_to_id];
+    }
+
+    void TransportRouter::BuildGraph() {
+        const auto buses = db_.GetAllBuses();
+
+        // Рёбра и вершины маршрутов считаются заранее точно: каждый автобус заполняет свой отрезок
+        // общих массивов, и номера рёбер не зависят от числа потоков
+        std::vector<graph::EdgeId> edge_offsets(buses.size() + 1, 0);
+        std::vector<graph::VertexId> route_vertex_offsets(buses.size() + 1, served_stop_ids_.size());
+        for (size_t bus_index = 0; bus_index < buses.size(); ++bus_index) {
+            size_t edge_count = 0;
+            size_t route_vertex_count = 0;
+            ForEachBusRange(*buses[bus_index], [&](size_t begin, size_t end) {
+                const size_t stop_count = end - begin;
+                edge_count += graph_model_ == GraphModel::SPAN ? stop_count + stop_count * (stop_count - 1) / 2
+                                                               : 3 * (stop_count - 1);
+                route_vertex_count += stop_count;
+            });
+            edge_offsets[bus_index + 1] = edge_offsets[bus_index] + edge_count;
+            route_vertex_offsets[bus_index + 1] = route_vertex_offsets[bus_index] + route_vertex_count;
+        }
+
+        std::vector<graph::Edge<RouteWeight>> edges(edge_offsets.back());
+        edges_data_.assign(edge_offsets.back(), EdgeData{});
+
+        graph::RunInParallel(buses.size(), graph_build_threads_, [&](size_t bus_index) {
+            const auto bus = buses[bus_index];
+            const auto dist_vec = db_.GetBusRealDistances(bus);
+            graph::EdgeId edge_id = edge_offsets[bus_index];
+            graph::VertexId route_vertex = route_vertex_offsets[bus_index];
+
+            const auto stop_ids = db_.GetBusStopIds(bus->id);
+            const auto bus_name = db_.GetBusName(bus->id);
+
+            ForEachBusRange(*bus, [&](size_t begin, size_t end) {
+                const auto stops_begin = std::next(stop_ids.begin(), begin);
+                const auto stops_end = std::next(stop_ids.begin(), end);
+                const auto dist_begin = std::next(dist_vec.begin(), begin);
+                if (graph_model_ == GraphModel::SPAN) {
+                    FillGraphByStopRange(stops_begin, stops_end, dist_begin, bus->id, bus_name,
+                                         edges, edge_id);
+                } else {
+                    FillGraphByRouteRange(stops_begin, stops_end, dist_begin, bus->id, bus_name,
+                                          edges, edge_id, route_vertex);
+                }
+            });
+        });
+
+        const size_t vertex_count = graph_model_ == GraphModel::SPAN ? served_stop_ids_.size() * 2
+                                                                     : route_vertex_offsets.back();
+        graph_ = Graph(vertex_count, std::move(edges));
+    }
+
     void TransportRouter::InitializeRouter() {
-        router_ = std::make_unique<graph::Router<double>>(graph_);
+        switch (engine_) {
+            case RouterEngine::ALL_PAIRS:
+                router_ = std::make_unique<graph::Router<RouteWeight>>(graph_, build_threads_);
+                break;
+            case RouterEngine::DIJKSTRA:
+                router_ = std::make_unique<graph::DijkstraRouter<RouteWeight>>(graph_);
+                break;
+            case RouterEngine::CONTRACTION_HIERARCHY:
+                router_ = std::make_unique<graph::ContractionHierarchy<RouteWeight>>(graph_);
+                break;
+            case RouterEngine::RAPTOR:
+                raptor_router_ = std::make_unique<RaptorRouter>(db_, wait_time_, bus_velocity_);
+                break;
+            case RouterEngine::A_STAR:
+                router_ = std::make_unique<graph::AStarRouter<RouteWeight>>(graph_, CollectVertexCoordinates(),
+                                                                            ComputeMinRideWeightPerMeter());
+                break;
+            case RouterEngine::HUB_LABELS:
+                router_ = std::make_unique<graph::HubLabels<RouteWeight>>(
+                        graph_, graph::ContractionHierarchy<RouteWeight>(graph_).GetRanks());
+                break;
+            case RouterEngine::LAZY_ALL_PAIRS:
+                router_ = std::make_unique<graph::LazyRouter<RouteWeight>>(graph_, route_cache_bytes_);
+                break;
+        }
+    }
+
+    void TransportRouter::InitializeTimetableRouter() {
+        timetable_router_ = std::make_unique<ConnectionScanRouter>(db_, bus_velocity_);
+    }
+
+    // Вершина получает координаты своей остановки: концы рёбер ожидания и выхода всегда принадлежат
+    // одной остановке, а без таких рёбер вершина не участвует ни в одном маршруте
+    std::vector<geo::Coordinates> TransportRouter::CollectVertexCoordinates() const {
+        std::vector<geo::Coordinates> coordinates(graph_.GetVertexCount(), geo::Coordinates{0, 0});
+
+        for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            const auto &edge_data = edges_data_[edge_id];
+            if (edge_data.type == EdgeType::RIDE) {
+                continue;
+            }
+            const auto &edge = graph_.GetEdge(edge_id);
+            coordinates[edge.from] = coordinates[edge.to] = db_.GetStopCoordinates(edge_data.id);
+        }
+        return coordinates;
+    }
+
+    // Дорожное расстояние может быть меньше расстояния по прямой, поэтому скорость по прямой оценивается
+    // наименьшим отношением дорожного расстояния к прямому по всем перегонам. Запас 1e-6 покрывает
+    // погрешность вычисления расстояний и сохраняет допустимость оценки. Результат — в единицах веса рёбер.
+    double TransportRouter::ComputeMinRideWeightPerMeter() const {
+        double min_ratio = std::numeric_limits<double>::infinity();
+
+        for (const auto &bus: db_.GetAllBuses()) {
+            const auto dist_vec = db_.GetBusRealDistances(bus);
+            const auto stop_ids = db_.GetBusStopIds(bus->id);
+            for (size_t i = 0; i + 1 < stop_ids.size(); ++i) {
+                const double geo_distance = geo::ComputeDistance(db_.GetStopCoordinates(stop_ids.begin()[i]),
+                                                                 db_.GetStopCoordinates(stop_ids.begin()[i + 1]));
+                if (geo_distance > 0) {
+                    min_ratio = std::min(min_ratio, dist_vec[i] / geo_distance);
+                }
+            }
+        }
+
+        if (min_ratio == std::numeric_limits<double>::infinity()) {
+            return 0;
+        }
+        return min_ratio * (1 - 1e-6) / bus_velocity_ * WEIGHT_UNITS_PER_MINUTE;
     }
 
     std::optional<std::vector<std::variant<BusItem, WaitItem>>>
     TransportRouter::GetRoute(std::string_view from, std::string_view to) const {
-        if (const auto stop_from_info = db_.GetStopInfo(from),
-                    stop_to_info = db_.GetStopInfo(to);
-                !stop_from_info ||
-                !stop_to_info ||
-                stop_from_info->buses.empty() ||
-                stop_to_info->buses.empty()) {
+        const auto stop_from = db_.FindStop(from);
+        const auto stop_to = db_.FindStop(to);
+        if (!stop_from || !stop_to || !AreConnected(stop_from->id, stop_to->id)) {
             return std::nullopt;
         }
 
-        const auto stop_from = db_.FindStop(from);
-        const auto stop_to = db_.FindStop(to);
-        auto res = router_->BuildRoute(stop_from->id * 2, stop_to->id * 2);
+        if (engine_ == RouterEngine::RAPTOR) {
+            return GetRaptorRoute(stop_from->id, stop_to->id);
+        }
+
+        auto res = router_->BuildRoute(GetStopVertex(stop_from->id), GetStopVertex(stop_to->id));
 
         if (res) {
             std::vector<std::variant<BusItem, WaitItem>> route;
             route.reserve(res->edges.size());
+            bool is_riding = false;
             for (const auto &edge: res->edges) {
-                if (edges_data_.at(edge).span) {
-                    route.emplace_back(BusItem{edges_data_.at(edge).name,
-                                               graph_.GetEdge(edge).weight,
-                                               edges_data_.at(edge).span,});
-                } else {
-                    route.emplace_back(WaitItem{edges_data_.at(edge).name,
-                                                graph_.GetEdge(edge).weight});
+                const auto &edge_data = edges_data_.at(edge);
+                switch (edge_data.type) {
+                    case EdgeType::WAIT:
+                        route.emplace_back(WaitItem{edge_data.name, ToMinutes(graph_.GetEdge(edge).weight)});
+                        is_riding = false;
+                        break;
+                    case EdgeType::RIDE:
+                        // Подряд идущие рёбра поездки без выхода — один отрезок на автобусе
+                        if (is_riding) {
+                            auto &bus_item = std::get<BusItem>(route.back());
+                            bus_item.time += ToMinutes(graph_.GetEdge(edge).weight);
+                            bus_item.span += edge_data.span;
+                        } else {
+                            route.emplace_back(BusItem{edge_data.name, ToMinutes(graph_.GetEdge(edge).weight),
+                                                       edge_data.span});
+                        }
+                        is_riding = graph_model_ == GraphModel::ROUTE;
+                        break;
+                    case EdgeType::ALIGHT:
+                        is_riding = false;
+                        break;
                 }
             }
             return route;
@@ -80,13 +527,188 @@ namespace transport_catalogue {
         return std::nullopt;
     }
 
+    std::optional<std::vector<ReachableStop>>
+    TransportRouter::GetReachableStops(std::string_view from, double max_time) const {
+        const auto stop_from = db_.FindStop(from);
+        if (!stop_from) {
+            return std::nullopt;
+        }
+
+        std::vector<ReachableStop> reachable_stops;
+        if (engine_ == RouterEngine::RAPTOR) {
+            for (const auto &[stop_id, time]: raptor_router_->FindReachableStops(stop_from->id, max_time)) {
+                reachable_stops.push_back({db_.GetStopName(stop_id), time});
+            }
+        } else if (stop_indices_[stop_from->id] == NO_STOP_INDEX) {
+            reachable_stops.push_back({stop_from->stop_name, 0});
+        } else {
+            // Время до остановки — время прибытия в её вершину, до ожидания автобуса
+            for (const auto &[vertex, weight]: graph::FindReachableVertices(graph_, GetStopVertex(stop_from->id),
+                                                                           ToRouteWeightBudget(max_time))) {
+                if (const auto stop_id = GetVertexStop(vertex)) {
+                    reachable_stops.push_back({db_.GetStopName(*stop_id), ToMinutes(weight)});
+                }
+            }
+        }
+
+        std::sort(reachable_stops.begin(), reachable_stops.end(), [](const auto &lhs, const auto &rhs) {
+            return std::tie(lhs.time, lhs.name) < std::tie(rhs.time, rhs.name);
+        });
+        return reachable_stops;
+    }
+
+    std::vector<std::optional<double>>
+    TransportRouter::GetTravelTimes(const std::vector<std::string_view> &from,
+                                    const std::vector<std::string_view> &to) const {
+        // Как и в GetRoute, остановки без автобусов не участвуют в маршрутах
+        auto find_stop_id = [this](std::string_view name) -> std::optional<size_t> {
+            const auto stop = db_.FindStop(name);
+            if (!stop || stop_components_[stop->id] == NO_COMPONENT) {
+                return std::nullopt;
+            }
+            return stop->id;
+        };
+
+        std::vector<std::optional<size_t>> to_stop_ids;
+        to_stop_ids.reserve(to.size());
+        for (const auto name: to) {
+            to_stop_ids.push_back(find_stop_id(name));
+        }
+
+        auto to_minutes = [](const std::optional<RouteWeight> &weight) -> std::optional<double> {
+            if (!weight) {
+                return std::nullopt;
+            }
+            return ToMinutes(*weight);
+        };
+
+        std::vector<graph::VertexId> to_vertices;
+        std::vector<std::optional<double>> times;
+        times.reserve(from.size() * to.size());
+        std::vector<double> stop_times;
+
+        for (const auto name: from) {
+            const auto from_stop_id = find_stop_id(name);
+            if (!from_stop_id) {
+                times.resize(times.size() + to.size());
+                continue;
+            }
+
+            if (engine_ == RouterEngine::ALL_PAIRS || engine_ == RouterEngine::HUB_LABELS ||
+                engine_ == RouterEngine::LAZY_ALL_PAIRS) {
+                for (const auto to_stop_id: to_stop_ids) {
+                    times.push_back(to_stop_id && AreConnected(*from_stop_id, *to_stop_id)
+                                    ? to_minutes(router_->GetRouteWeight(GetStopVertex(*from_stop_id),
+                                                                         GetStopVertex(*to_stop_id)))
+                                    : std::nullopt);
+                }
+            } else if (engine_ == RouterEngine::RAPTOR) {
+                stop_times.assign(db_.GetLastStopId(), std::numeric_limits<double>::infinity());
+                for (const auto &[stop_id, time]: raptor_router_->FindReachableStops(
+                        *from_stop_id, std::numeric_limits<double>::infinity())) {
+                    stop_times[stop_id] = time;
+                }
+                for (const auto to_stop_id: to_stop_ids) {
+                    if (to_stop_id && stop_times[*to_stop_id] != std::numeric_limits<double>::infinity()) {
+                        times.emplace_back(stop_times[*to_stop_id]);
+                    } else {
+                        times.emplace_back(std::nullopt);
+                    }
+                }
+            } else {
+                // Цели из других компонент недостижимы: без них поиск останавливается раньше
+                to_vertices.clear();
+                for (const auto to_stop_id: to_stop_ids) {
+                    if (to_stop_id && AreConnected(*from_stop_id, *to_stop_id)) {
+                        to_vertices.push_back(GetStopVertex(*to_stop_id));
+                    }
+                }
+                const auto route_weights = graph::ComputeRouteWeights(graph_, GetStopVertex(*from_stop_id),
+                                                                      to_vertices);
+                auto route_weight_it = route_weights.begin();
+                for (const auto to_stop_id: to_stop_ids) {
+                    times.push_back(to_stop_id && AreConnected(*from_stop_id, *to_stop_id)
+                                    ? to_minutes(*route_weight_it++)
+                                    : std::nullopt);
+                }
+            }
+        }
+        return times;
+    }
+
+    std::optional<std::vector<std::variant<BusItem, WaitItem>>>
+    TransportRouter::GetTimetableRoute(std::string_view from, std::string_view to, double departure_time) const {
+        const auto stop_from = db_.FindStop(from);
+        const auto stop_to = db_.FindStop(to);
+        if (!stop_from || !stop_to) {
+            return std::nullopt;
+        }
+
+        const auto legs = timetable_router_->BuildRoute(stop_from->id, stop_to->id, departure_time);
+        if (!legs) {
+            return std::nullopt;
+        }
+
+        std::vector<std::variant<BusItem, WaitItem>> route;
+        route.reserve(legs->size() * 2);
+        double time = departure_time;
+        for (const auto &leg: *legs) {
+            route.emplace_back(WaitItem{db_.GetStopName(leg.board_stop_id), leg.departure_time - time});
+            route.emplace_back(BusItem{db_.GetBusName(leg.bus_id), leg.arrival_time - leg.departure_time,
+                                       leg.span});
+            time = leg.arrival_time;
+        }
+        return route;
+    }
+
+    std::optional<std::vector<std::variant<BusItem, WaitItem>>>
+    TransportRouter::GetRaptorRoute(size_t stop_from_id, size_t stop_to_id) const {
+        const auto legs = raptor_router_->BuildRoute(stop_from_id, stop_to_id);
+        if (!legs) {
+            return std::nullopt;
+        }
+
+        std::vector<std::variant<BusItem, WaitItem>> route;
+        route.reserve(legs->size() * 2);
+        for (const auto &leg: *legs) {
+            route.emplace_back(WaitItem{db_.GetStopName(leg.board_stop_id), 1.0 * wait_time_});
+            route.emplace_back(BusItem{db_.GetBusName(leg.bus_id), leg.time, leg.span});
+        }
+        return route;
+    }
+
+    std::optional<graph::RouteCacheStats> TransportRouter::GetRouteCacheStats() const {
+        if (engine_ != RouterEngine::LAZY_ALL_PAIRS) {
+            return std::nullopt;
+        }
+        return static_cast<const graph::LazyRouter<RouteWeight> &>(*router_).GetCacheStats();
+    }
+
     transport_catalogue_protobuf::TransportRouter TransportRouter::Serialize() const {
         transport_catalogue_protobuf::TransportRouter proto_transport_router;
 
         *proto_transport_router.mutable_settings() = std::move(SerializeSettings());
+        proto_transport_router.mutable_stop_components()->Add(stop_components_.begin(), stop_components_.end());
+        proto_transport_router.mutable_stop_indices()->Add(stop_indices_.begin(), stop_indices_.end());
+        if (engine_ == RouterEngine::RAPTOR) {
+            return proto_transport_router;
+        }
         *proto_transport_router.mutable_graph() = std::move(graph_.Serialize());
         *proto_transport_router.mutable_edges_data() = std::move(SerializeEdgesData());
-        *proto_transport_router.mutable_router_routes_internal_data() = std::move(router_->Serialize());
+        if (engine_ == RouterEngine::ALL_PAIRS) {
+            const auto &router = static_cast<const graph::Router<RouteWeight> &>(*router_);
+            if (route_table_format_ == RouteTableFormat::NESTED) {
+                *proto_transport_router.mutable_router_routes_internal_data() = std::move(router.Serialize());
+            } else if (route_table_format_ == RouteTableFormat::PACKED) {
+                *proto_transport_router.mutable_router_routes_internal_data() = std::move(router.SerializePacked());
+            }
+        } else if (engine_ == RouterEngine::CONTRACTION_HIERARCHY) {
+            *proto_transport_router.mutable_contraction_hierarchy() = std::move(
+                    static_cast<const graph::ContractionHierarchy<RouteWeight> &>(*router_).Serialize());
+        } else if (engine_ == RouterEngine::HUB_LABELS) {
+            *proto_transport_router.mutable_hub_labels() = std::move(
+                    static_cast<const graph::HubLabels<RouteWeight> &>(*router_).Serialize());
+        }
 
         return proto_transport_router;
     }
@@ -96,6 +718,14 @@ namespace transport_catalogue {
 
         proto_route_settings.set_bus_velocity(bus_velocity_);
         proto_route_settings.set_bus_wait_time(wait_time_);
+        proto_route_settings.set_router_engine(static_cast<transport_catalogue_protobuf::RouterEngine>(engine_));
+        proto_route_settings.set_build_threads(build_threads_);
+        proto_route_settings.set_graph_build_threads(graph_build_threads_);
+        proto_route_settings.set_graph_model(static_cast<transport_catalogue_protobuf::GraphModel>(graph_model_));
+        proto_route_settings.set_integer_weights(std::is_integral_v<RouteWeight>);
+        proto_route_settings.set_route_cache_bytes(route_cache_bytes_);
+        proto_route_settings.set_route_table_format(
+                static_cast<transport_catalogue_protobuf::RouteTableFormat>(route_table_format_));
 
         return proto_route_settings;
     }
@@ -104,14 +734,57 @@ namespace transport_catalogue {
     TransportRouter::DeserializeSettings(const transport_catalogue_protobuf::RouteSettings &proto_router_settings) {
         bus_velocity_ = proto_router_settings.bus_velocity();
         wait_time_ = proto_router_settings.bus_wait_time();
+        engine_ = static_cast<RouterEngine>(proto_router_settings.router_engine());
+        build_threads_ = proto_router_settings.build_threads();
+        graph_build_threads_ = proto_router_settings.graph_build_threads();
+        graph_model_ = static_cast<GraphModel>(proto_router_settings.graph_model());
+        route_cache_bytes_ = proto_router_settings.route_cache_bytes();
+        route_table_format_ = static_cast<RouteTableFormat>(proto_router_settings.route_table_format());
+        if (proto_router_settings.integer_weights() != std::is_integral_v<RouteWeight>) {
+            throw std::runtime_error("Base was built with another route weight type");
+        }
     }
 
     void TransportRouter::Deserialize(const transport_catalogue_protobuf::TransportRouter &proto_transport_router) {
 
         DeserializeSettings(proto_transport_router.settings());
+        stop_components_.assign(proto_transport_router.stop_components().begin(),
+                                proto_transport_router.stop_components().end());
+        stop_indices_.assign(proto_transport_router.stop_indices().begin(),
+                             proto_transport_router.stop_indices().end());
+        // Базы прежних форматов (без компонент связности и номеров вершин остановок, с графом из списков
+        // смежности) не читаются: их нужно пересобрать через make_base
+        if (stop_components_.size() != db_.GetLastStopId() || stop_indices_.size() != db_.GetLastStopId()) {
+            throw std::runtime_error("Base format is too old: stop indices are missing, rebuild the base");
+        }
+        served_stop_ids_.clear();
+        for (size_t stop_id = 0; stop_id < stop_indices_.size(); ++stop_id) {
+            if (stop_indices_[stop_id] != NO_STOP_INDEX) {
+                served_stop_ids_.push_back(stop_id);
+            }
+        }
+        InitializeTimetableRouter();
+        if (engine_ == RouterEngine::RAPTOR) {
+            InitializeRouter();
+            return;
+        }
+        if (proto_transport_router.graph().offsets().empty() ||
+            proto_transport_router.graph().edge_ids_size() != proto_transport_router.edges_data().edges_data_size()) {
+            throw std::runtime_error("Base format is too old: route graph is missing, rebuild the base");
+        }
         graph_.Deserialize(proto_transport_router.graph());
         DeserializeEdgesData(proto_transport_router.edges_data());
-        router_ = std::make_unique<graph::Router<double>>(graph_, proto_transport_router.router_routes_internal_data());
+        if (engine_ == RouterEngine::ALL_PAIRS && route_table_format_ != RouteTableFormat::REBUILD) {
+            router_ = std::make_unique<graph::Router<RouteWeight>>(
+                    graph_, proto_transport_router.router_routes_internal_data());
+        } else if (engine_ == RouterEngine::CONTRACTION_HIERARCHY) {
+            router_ = std::make_unique<graph::ContractionHierarchy<RouteWeight>>(
+                    graph_, proto_transport_router.contraction_hierarchy());
+        } else if (engine_ == RouterEngine::HUB_LABELS) {
+            router_ = std::make_unique<graph::HubLabels<RouteWeight>>(graph_, proto_transport_router.hub_labels());
+        } else {
+            InitializeRouter();
+        }
 
     }
 
@@ -120,16 +793,14 @@ namespace transport_catalogue {
         edges_data_.clear();
         edges_data_.reserve(proto_edges_data.edges_data_size());
 
-        const auto stops = db_.GetAllStops();
-        const auto buses = db_.GetAllBuses();
-
         for (const auto &proto_edge_data: proto_edges_data.edges_data()) {
             auto span = proto_edge_data.span();
+            auto type = static_cast<EdgeType>(proto_edge_data.type());
 
-            std::string_view name = span ? (*std::next(buses.begin(), proto_edge_data.id()).base())->bus_name :
-                                    (*std::next(stops.begin(), proto_edge_data.id()).base())->stop_name;
+            std::string_view name = type == EdgeType::RIDE ? db_.GetBusName(proto_edge_data.id())
+                                                           : db_.GetStopName(proto_edge_data.id());
 
-            edges_data_.emplace_back(EdgeData{proto_edge_data.id(), name, span});
+            edges_data_.emplace_back(EdgeData{proto_edge_data.id(), name, span, type});
         }
     }
 
@@ -140,6 +811,7 @@ namespace transport_catalogue {
             transport_catalogue_protobuf::EdgeData proto_edge_data;
             proto_edge_data.set_span(edge_data.span);
             proto_edge_data.set_id(edge_data.id);
+            proto_edge_data.set_type(static_cast<transport_catalogue_protobuf::EdgeType>(edge_data.type));
             *proto_edges_data.add_edges_data() = std::move(proto_edge_data);
         }
         return proto_edges_data;
@@ -148,14 +820,16 @@ namespace transport_catalogue {
     template<class StopIter, class DistIter>
     void
     TransportRouter::FillGraphByStopRange(const StopIter begin, const StopIter end, const DistIter dist_vector_begin,
-                                          size_t bus_id, std::string_view bus_name) {
+                                          size_t bus_id, std::string_view bus_name,
+                                          std::vector<graph::Edge<RouteWeight>> &edges, graph::EdgeId &edge_id) {
         int stop_id = 0;
 
         for (auto stop_it = begin; stop_it != end; ++stop_it, ++stop_id) {
-            graph_.AddEdge({(*stop_it)->id * 2,
-                            (*stop_it)->id * 2 + 1,
-                            1.0 * wait_time_});
-            edges_data_.push_back({(*stop_it)->id, (*stop_it)->stop_name, 0});
+            const auto stop_vertex = GetStopVertex(*stop_it);
+            edges[edge_id] = {stop_vertex,
+                              stop_vertex + 1,
+                              ToRouteWeight(wait_time_)};
+            edges_data_[edge_id++] = {*stop_it, db_.GetStopName(*stop_it), 0};
 
             if (stop_it == std::prev(end)) { break; }
 
@@ -164,11 +838,37 @@ namespace transport_catalogue {
 
             for (auto next_stop = std::next(stop_it); next_stop != end; ++next_stop, ++span) {
                 r_length += *std::next(dist_vector_begin, stop_id + span);
-                graph_.AddEdge({(*stop_it)->id * 2 + 1,
-                                (*next_stop)->id * 2,
-                                1.0 * r_length / bus_velocity_});
-                edges_data_.push_back({bus_id, bus_name, span + 1});
+                edges[edge_id] = {stop_vertex + 1,
+                                  GetStopVertex(*next_stop),
+                                  ToRouteWeight(r_length / bus_velocity_)};
+                edges_data_[edge_id++] = {bus_id, bus_name, span + 1, EdgeType::RIDE};
             }
         }
     }
+
+    template<class StopIter, class DistIter>
+    void
+    TransportRouter::FillGraphByRouteRange(const StopIter begin, const StopIter end, const DistIter dist_vector_begin,
+                                           size_t bus_id, std::string_view bus_name,
+                                           std::vector<graph::Edge<RouteWeight>> &edges, graph::EdgeId &edge_id,
+                                           graph::VertexId &route_vertex) {
+        auto dist_it = dist_vector_begin;
+
+        for (auto stop_it = begin; stop_it != end; ++stop_it, ++dist_it, ++route_vertex) {
+            const auto stop_vertex = GetStopVertex(*stop_it);
+
+            if (stop_it != begin) {
+                edges[edge_id] = {route_vertex, stop_vertex, RouteWeight{}};
+                edges_data_[edge_id++] = {*stop_it, db_.GetStopName(*stop_it), 0, EdgeType::ALIGHT};
+            }
+
+            if (stop_it == std::prev(end)) { continue; }
+
+            edges[edge_id] = {stop_vertex, route_vertex, ToRouteWeight(wait_time_)};
+            edges_data_[edge_id++] = {*stop_it, db_.GetStopName(*stop_it), 0, EdgeType::WAIT};
+
+            edges[edge_id] = {route_vertex, route_vertex + 1, ToRouteWeight(*dist_it / bus_velocity_)};
+            edges_data_[edge_id++] = {bus_id, bus_name, 1, EdgeType::RIDE};
+        }
+    }
 }
\ No newline at end of file
@@ -1,20 +1,40 @@
 #pragma once
 
+#include <cstdint>
+#include <limits>
 #include <unordered_map>
 #include <memory>
+#include <string>
+#include <tuple>
 #include <variant>
 #include "transport_catalogue.h"
 #include "graph.h"
 #include "router.h"
+#include "dijkstra_router.h"
+#include "astar_router.h"
+#include "contraction_hierarchy.h"
+#include "hub_labels.h"
+#include "lazy_router.h"
+#include "raptor_router.h"
+#include "connection_scan_router.h"
 #include "domain.h"
 #include "transport_router.pb.h"
 
 namespace transport_catalogue {
 
+    // WAIT — ожидание автобуса на остановке, RIDE — поездка, ALIGHT — выход из автобуса
+    // (только в модели графа GraphModel::ROUTE)
+    enum class EdgeType {
+        WAIT,
+        RIDE,
+        ALIGHT,
+    };
+
     struct EdgeData {
         size_t id = 0;
         std::string_view name;
         int span = 0;
+        EdgeType type = EdgeType::WAIT;
     };
 
     struct BusItem {
@@ -28,9 +48,66 @@ namespace transport_catalogue {
         double time = 0;
     };
 
+    struct ReachableStop {
+        std::string_view name;
+        double time = 0;
+    };
+
+    enum class RouterEngine {
+        ALL_PAIRS,
+        DIJKSTRA,
+        CONTRACTION_HIERARCHY,
+        // Поиск по раундам прямо по маршрутам автобусов: граф и таблица маршрутов не строятся
+        RAPTOR,
+        // Дейкстра с нижней оценкой времени до цели по координатам остановок
+        A_STAR,
+        // Метки хабов в порядке рангов иерархии сжатий: запрос — слияние двух меток
+        HUB_LABELS,
+        // Строки таблицы all_pairs считаются при первом запросе и живут в кэше LRU ограниченного размера
+        LAZY_ALL_PAIRS,
+    };
+
+    RouterEngine ParseRouterEngine(std::string_view name);
+
+    // SPAN — по ребру от каждой остановки маршрута до каждой следующей, O(L²) рёбер на маршрут;
+    // ROUTE — у маршрута своя цепочка вершин с рёбрами посадки и выхода, O(L) рёбер
+    enum class GraphModel {
+        SPAN,
+        ROUTE,
+    };
+
+    GraphModel ParseGraphModel(std::string_view name);
+
+    // Как таблица all_pairs попадает в базу: NESTED — сообщение на каждую ячейку V×V (так таблица
+    // хранилась до PACKED; сами базы тех версий не читаются — см. Deserialize, их нужно пересобрать);
+    // PACKED — два упакованных массива весов и последних рёбер; REBUILD — не сохраняется
+    // и строится заново по графу при загрузке.
+    // По умолчанию PACKED: база почти такая же, как NESTED (веса занимают те же байты), зато читается
+    // в разы быстрее — нет разбора сообщения на каждую ячейку. REBUILD даёт самую маленькую базу,
+    // но каждый process_requests заново выполняет Флойда–Уоршелла за O(V³) и всё равно держит
+    // таблицу V×V в памяти, поэтому годится только для небольших графов
+    enum class RouteTableFormat {
+        NESTED,
+        PACKED,
+        REBUILD,
+    };
+
+    RouteTableFormat ParseRouteTableFormat(std::string_view name);
+
+#ifdef TRANSPORT_CATALOGUE_INTEGER_WEIGHTS
+    // Вес ребра — целые децисекунды: времена получаются из целых метров и минут, и целый вес вдвое
+    // компактнее и позволяет искать маршруты с радиксной кучей. В минуты переводится только ответ
+    using RouteWeight = uint32_t;
+#else
+    using RouteWeight = double;
+#endif
+
 
     class TransportRouter {
-        using Graph = graph::DirectedWeightedGraph<double>;
+        using Graph = graph::DirectedWeightedGraph<RouteWeight>;
+
+        static constexpr uint32_t NO_COMPONENT = std::numeric_limits<uint32_t>::max();
+        static constexpr uint32_t NO_STOP_INDEX = std::numeric_limits<uint32_t>::max();
     public:
 
         void SetDb(const TransportCatalogue &db);
@@ -39,11 +116,48 @@ namespace transport_catalogue {
 
         void SetBusVelocity(double velocity);
 
+        void SetRouterEngine(RouterEngine engine);
+
+        // Потоки построения таблицы all_pairs
+        void SetBuildThreads(int threads);
+
+        // Потоки построения графа; на граф и ответы не влияют
+        void SetGraphBuildThreads(int threads);
+
+        void SetGraphModel(GraphModel model);
+
+        void SetRouteCacheBytes(double bytes);
+
+        void SetRouteTableFormat(RouteTableFormat format);
+
         void FillGraph();
 
+        // Справочник изменён после загрузки базы: граф строится заново. Таблица all_pairs в любой модели
+        // графа чинится только в затронутых метках, в том числе когда добавленные или удалённые автобусы
+        // меняют число вершин: вершины старого и нового графа сопоставляются по ключам из CollectVertexKeys.
+        // Остальные движки — сжатия, метки хабов, ленивые строки — строятся заново целиком
+        void UpdateDb(const TransportCatalogue &db);
+
         std::optional<std::vector<std::variant<BusItem, WaitItem>>>
         GetRoute(std::string_view from, std::string_view to) const;
 
+        // Маршрут по расписанию с самым ранним прибытием при отправлении из from не раньше departure_time
+        // (минуты от начала суток). Ожидание — время до отправления рейса, а не bus_wait_time
+        std::optional<std::vector<std::variant<BusItem, WaitItem>>>
+        GetTimetableRoute(std::string_view from, std::string_view to, double departure_time) const;
+
+        // Остановки, до которых из from можно добраться не дольше чем за max_time минут,
+        // по возрастанию времени (при равенстве — по названию)
+        std::optional<std::vector<ReachableStop>> GetReachableStops(std::string_view from, double max_time) const;
+
+        // Матрица времён в пути from × to построчно; без маршрута или для неизвестной остановки — nullopt.
+        // Вместо восстановления маршрутов — один поиск на источник (или готовая таблица all_pairs)
+        std::vector<std::optional<double>> GetTravelTimes(const std::vector<std::string_view> &from,
+                                                          const std::vector<std::string_view> &to) const;
+
+        // Счётчики кэша строк движка lazy_all_pairs; для других движков — nullopt
+        std::optional<graph::RouteCacheStats> GetRouteCacheStats() const;
+
         void Deserialize(const transport_catalogue_protobuf::TransportRouter &proto_transport_router);
 
         transport_catalogue_protobuf::TransportRouter Serialize() const;
@@ -58,19 +172,74 @@ namespace transport_catalogue {
 
         transport_catalogue_protobuf::EdgesData SerializeEdgesData() const;
 
+        // Рёбра участка пишутся в edges и edges_data_ начиная с edge_id, который сдвигается за последнее
         template<class StopIter, class DistIter>
         void FillGraphByStopRange(const StopIter begin, const StopIter end, const DistIter dist_vector_begin,
-                                  size_t bus_id, std::string_view bus_name);
+                                  size_t bus_id, std::string_view bus_name,
+                                  std::vector<graph::Edge<RouteWeight>> &edges, graph::EdgeId &edge_id);
+
+        template<class StopIter, class DistIter>
+        void FillGraphByRouteRange(const StopIter begin, const StopIter end, const DistIter dist_vector_begin,
+                                   size_t bus_id, std::string_view bus_name,
+                                   std::vector<graph::Edge<RouteWeight>> &edges, graph::EdgeId &edge_id,
+                                   graph::VertexId &route_vertex);
+
+        // Вершины получают только остановки, через которые ходят автобусы: они нумеруются подряд
+        // в порядке номеров, и размер графа и таблицы маршрутов не зависит от остальных остановок
+        void IndexServedStops();
+
+        graph::VertexId GetStopVertex(size_t stop_id) const;
+
+        // Ключ вершины, не зависящий от нумерации: у вершин остановок — название остановки и часть
+        // (в модели SPAN у остановки две вершины), у вершин маршрутов модели ROUTE — название автобуса
+        // и позиция в его цепочке вершин
+        using VertexKey = std::tuple<bool, std::string, size_t>;
+
+        std::vector<VertexKey> CollectVertexKeys() const;
+
+        std::optional<size_t> GetVertexStop(graph::VertexId vertex) const;
+
+        // Каждый автобус проходит свои остановки по замкнутому циклу: некольцевой — туда и обратно, кольцевой
+        // по формату начинается и заканчивается одной остановкой. Поэтому остановки одного автобуса взаимно
+        // достижимы, и компоненты сильной связности графа по остановкам — это классы объединения остановок
+        // по автобусам. Если кольцо во входных данных не замкнуто, компонента лишь шире достижимости:
+        // маршрут не теряется, поиск просто не отсекается заранее. Остановка без автобусов — NO_COMPONENT
+        void ComputeStopComponents();
+
+        bool AreConnected(size_t stop_from_id, size_t stop_to_id) const;
+
+        // Рёбра строятся по автобусам на graph_build_threads_ потоках (0 — в текущем потоке)
+        void BuildGraph();
 
         void InitializeRouter();
 
+        void InitializeTimetableRouter();
+
+        std::vector<geo::Coordinates> CollectVertexCoordinates() const;
+
+        double ComputeMinRideWeightPerMeter() const;
+
+        std::optional<std::vector<std::variant<BusItem, WaitItem>>>
+        GetRaptorRoute(size_t stop_from_id, size_t stop_to_id) const;
+
         TransportCatalogue db_;
         Graph graph_;
-        std::unique_ptr<graph::Router<double>> router_;
+        std::unique_ptr<graph::RouteBuilder<RouteWeight>> router_;
+        std::unique_ptr<RaptorRouter> raptor_router_;
+        std::unique_ptr<ConnectionScanRouter> timetable_router_;
 
         std::vector<EdgeData> edges_data_;
+        std::vector<uint32_t> stop_components_;
+        std::vector<uint32_t> stop_indices_;
+        std::vector<size_t> served_stop_ids_;
         int wait_time_ = 1;
         double bus_velocity_ = 1;
+        RouterEngine engine_ = RouterEngine::ALL_PAIRS;
+        size_t build_threads_ = 0;
+        size_t graph_build_threads_ = 0;
+        GraphModel graph_model_ = GraphModel::SPAN;
+        size_t route_cache_bytes_ = 64 << 20;
+        RouteTableFormat route_table_format_ = RouteTableFormat::PACKED;
     };
 
 